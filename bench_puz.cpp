@@ -0,0 +1,584 @@
+// Copyright (c) 2022-2023 Robert A. Alfieri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// bench_puz [options]
+//
+// Benchmarks for gen_puz.  Writes a synthetic subject file and measures:
+//
+// - how many lines/sec each subject loader gets through
+// - how many answers/sec pick_words() gets through
+// - slot pattern queries/sec with a WordIndex versus scanning all words
+// - grid attempts/sec and placements/sec with the bitboards versus the scalar scoring code
+// - fill density of the csp engine on generated patterns versus greedy
+// - ThreadPool submit() and parallel_for() throughput, nesting, and shutdown()
+// - end-to-end puzzles/sec and p50/p99 latency for each side and thread count
+// - that -serve answers a good request and rejects bad ones, e.g., an empty subject
+// - the size of the word table, heap allocations, and peak RSS
+//
+// The results go to stdout as one JSON object so runs can be diffed.
+// "make bench" builds and runs it with the defaults.
+//
+#include "puz.h"                // puzzle data structures and generator
+
+#include <atomic>
+#include <new>
+#include <sys/resource.h>
+
+//-----------------------------------------------------------------------
+// Count heap allocations so that the benchmarks can report them.
+//-----------------------------------------------------------------------
+static std::atomic<uint64_t> alloc_cnt( 0 );
+
+void * operator new( size_t size )
+{
+    alloc_cnt++;
+    void * p = malloc( (size != 0) ? size : 1 );
+    if ( p == nullptr ) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete( void * p ) noexcept           { free( p ); }
+void operator delete( void * p, size_t ) noexcept   { free( p ); }
+
+// peak resident set size of this process in KB
+uint64_t peak_rss_kb( void )
+{
+    struct rusage ru;
+    getrusage( RUSAGE_SELF, &ru );
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024;         // bytes on macOS
+#else
+    return ru.ru_maxrss;
+#endif
+}
+
+//-----------------------------------------------------------------------
+// Synthetic subject files in the usual two-line Q/A format, with some
+// blank lines, comments, and surrounding whitespace.  Answer words have
+// min_syl..max_syl syllables and accent_pct% of them end in an accented
+// letter.
+//-----------------------------------------------------------------------
+struct SynthOptions
+{
+    uint32_t    entry_cnt   = 200000;
+    uint32_t    min_syl     = 2;
+    uint32_t    max_syl     = 5;
+    uint32_t    accent_pct  = 15;
+};
+
+// returns the number of lines written
+uint32_t synth_subject( std::string path, const SynthOptions& so )
+{
+    static const char * syllables[] = { "ca", "pi", "to", "ne", "ro", "la", "mi", "so", "ve", "du", "gli", "chi",
+                                        "ste", "bra", "ten", "por", "an", "el", "ri", "zo", "fa", "lu", "co", "de" };
+    static const char * accented[]  = { "à", "è", "é", "ì", "ò", "ù" };
+    const uint32_t syllable_cnt = sizeof(syllables) / sizeof(syllables[0]);
+    const uint32_t accented_cnt = sizeof(accented) / sizeof(accented[0]);
+    auto word = [&]( std::string& s )
+    {
+        uint32_t cnt = so.min_syl + rand_n( so.max_syl - so.min_syl + 1 );
+        for( uint32_t i = 0; i < cnt; i++ ) s += syllables[rand_n( syllable_cnt )];
+        if ( rand_n( 100 ) < so.accent_pct ) s += accented[rand_n( accented_cnt )];
+    };
+    auto phrase = [&]( std::string& s, uint32_t max_cnt )
+    {
+        uint32_t cnt = 1 + rand_n( max_cnt );
+        for( uint32_t i = 0; i < cnt; i++ )
+        {
+            if ( i != 0 ) s += " ";
+            word( s );
+        }
+    };
+
+    std::string s = "# synthetic subject file\n\n";
+    uint32_t line_cnt = 2;
+    for( uint32_t e = 0; e < so.entry_cnt; e++ )
+    {
+        s += "  ";
+        phrase( s, 4 );
+        s += " \n\t";
+        uint32_t a_cnt = 1 + rand_n( 2 );
+        for( uint32_t a = 0; a < a_cnt; a++ )
+        {
+            if ( a != 0 ) s += "; ";
+            phrase( s, 3 );
+        }
+        if ( rand_n( 10 ) == 0 ) s += " (note)";
+        s += "\n";
+        line_cnt += 2;
+        if ( rand_n( 5 ) == 0 ) {
+            s += "\n";
+            line_cnt++;
+        }
+    }
+    std::ofstream out( path );
+    dassert( out.is_open(), "could not open file " + path + " for output" );
+    out << s;
+    out.close();
+    return line_cnt;
+}
+
+//-----------------------------------------------------------------------
+// The original loader: readline() plus std::regex trimming.
+//-----------------------------------------------------------------------
+void load_legacy( std::string path, std::vector<std::pair<std::string, std::string>>& qas )
+{
+    std::regex ws1( "^\\s+" );
+    std::regex ws2( "\\s+$" );
+    std::ifstream Q( path );
+    dassert( Q.is_open(), "could not open file " + path + " for input" );
+    uint32_t line_num = 0;
+    for( ;; )
+    {
+        std::string question = readline( Q );
+        if ( question == "" ) break;
+        line_num++;
+        question = replace( question, ws1, "" );
+        question = replace( question, ws2, "" );
+        if ( question.length() == 0 or question[0] == '#' ) continue;
+
+        std::string answer = readline( Q );
+        answer = replace( answer, ws1, "" );
+        answer = replace( answer, ws2, "" );
+        dassert( answer.length() != 0, "question on line " + std::to_string(line_num) + " is not followed by a non-blank answer on the next line: " + question );
+        line_num++;
+        qas.push_back( std::make_pair( question, answer ) );
+    }
+    Q.close();
+}
+
+//-----------------------------------------------------------------------
+// Percentile of a list of latencies (sorts it).
+//-----------------------------------------------------------------------
+real64 percentile( std::vector<real64>& v, uint32_t pct )
+{
+    if ( v.size() == 0 ) return 0.0;
+    std::sort( v.begin(), v.end() );
+    size_t i = (v.size() - 1) * pct / 100;
+    return v[i];
+}
+
+std::vector<uint32_t> parse_list( std::string s )
+{
+    std::vector<uint32_t> v;
+    for( const std::string& e: split( s, ',' ) ) v.push_back( std::stoi( e ) );
+    return v;
+}
+
+int main( int argc, const char * argv[] )
+{
+    //-----------------------------------------------------------------------
+    // process command line args
+    //-----------------------------------------------------------------------
+    uint64_t              seed        = 1;
+    SynthOptions          so;
+    uint32_t              iters       = 3;
+    std::string           path        = "bench_subject.txt";
+    std::vector<uint32_t> sides       = { 9, 13, 17, 25, 33, 41 };
+    std::vector<uint32_t> threads     = { 1, 2, 4 };
+    uint32_t              puzzles     = 20;       // per side and thread count
+    uint32_t              attempts    = 10000;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        std::string arg = argv[i];
+               if ( arg == "-seed" ) {                          seed = std::stoll( argv[++i] );
+        } else if ( arg == "-entry_cnt" ) {                     so.entry_cnt = std::stoi( argv[++i] );
+        } else if ( arg == "-min_syl" ) {                       so.min_syl = std::stoi( argv[++i] );
+        } else if ( arg == "-max_syl" ) {                       so.max_syl = std::stoi( argv[++i] );
+        } else if ( arg == "-accent_pct" ) {                    so.accent_pct = std::stoi( argv[++i] );
+        } else if ( arg == "-iters" ) {                         iters = std::stoi( argv[++i] );
+        } else if ( arg == "-path" ) {                          path = argv[++i];
+        } else if ( arg == "-sides" ) {                         sides = parse_list( argv[++i] );
+        } else if ( arg == "-threads" ) {                       threads = parse_list( argv[++i] );
+        } else if ( arg == "-puzzles" ) {                       puzzles = std::stoi( argv[++i] );
+        } else if ( arg == "-attempts" ) {                      attempts = std::stoi( argv[++i] );
+        } else {                                                die( "unknown option: " + arg ); }
+    }
+    dassert( so.min_syl >= 1 && so.min_syl <= so.max_syl, "need 1 <= min_syl <= max_syl" );
+    rand_thread_seed( seed );
+
+    uint32_t line_cnt = synth_subject( path, so );
+    std::cout << "{\n";
+    std::cout << "\"corpus\": {\"path\": " << json_str( path ) << ", \"seed\": " << seed << ", \"entry_cnt\": " << so.entry_cnt <<
+                 ", \"line_cnt\": " << line_cnt << ", \"min_syl\": " << so.min_syl << ", \"max_syl\": " << so.max_syl <<
+                 ", \"accent_pct\": " << so.accent_pct << "},\n";
+
+    //-----------------------------------------------------------------------
+    // Time each loader and check that they produce the same entries.
+    //-----------------------------------------------------------------------
+    real64 legacy_secs = 0.0;
+    std::vector<std::pair<std::string, std::string>> qas;
+    for( uint32_t i = 0; i < iters; i++ )
+    {
+        qas.clear();
+        real64 start = clock_monotonic_time();
+        load_legacy( path, qas );
+        legacy_secs += clock_monotonic_time() - start;
+    }
+
+    real64 fast_secs = 0.0;
+    std::string text;
+    std::vector<Entry> entries;
+    for( uint32_t i = 0; i < iters; i++ )
+    {
+        real64 start = clock_monotonic_time();
+        file_read( path, text );
+        parse_subject( text, entries );
+        fast_secs += clock_monotonic_time() - start;
+    }
+
+    dassert( qas.size() == entries.size(), "loaders disagree on the number of entries" );
+    for( size_t i = 0; i < qas.size(); i++ )
+    {
+        dassert( entries[i].q == qas[i].first && entries[i].a == qas[i].second, "loaders disagree on entry " + std::to_string(i) );
+    }
+
+    real64 legacy_lps = real64(line_cnt) * iters / legacy_secs;
+    real64 fast_lps   = real64(line_cnt) * iters / fast_secs;
+    std::cout << "\"parse\": {\"legacy_lines_per_sec\": " << uint64_t(legacy_lps) << ", \"fast_lines_per_sec\": " << uint64_t(fast_lps) <<
+                 ", \"fast_mb_per_sec\": " << (real64(text.length()) * iters / fast_secs / 1e6) <<
+                 ", \"speedup\": " << (fast_lps / legacy_lps) << "},\n";
+
+    //-----------------------------------------------------------------------
+    // Word extraction from the answers.
+    //-----------------------------------------------------------------------
+    std::vector<PickedWord> picked;
+    uint64_t picked_cnt = 0;
+    real64 start = clock_monotonic_time();
+    for( uint32_t i = 0; i < iters; i++ )
+    {
+        for( const Entry& e: entries )
+        {
+            // answers are separated by ';' as in Subject::build_image()
+            for( size_t a_first = 0; ; )
+            {
+                size_t semi = e.a.find( ';', a_first );
+                pick_words( trim_left( e.a.substr( a_first, (semi == std::string_view::npos) ? std::string_view::npos : (semi - a_first) ) ), picked );
+                picked_cnt += picked.size();
+                if ( semi == std::string_view::npos ) break;
+                a_first = semi + 1;
+            }
+        }
+    }
+    real64 pick_secs = clock_monotonic_time() - start;
+    std::cout << "\"pick_words\": {\"answers_per_sec\": " << uint64_t(real64(entries.size()) * iters / pick_secs) <<
+                 ", \"words_per_sec\": " << uint64_t(real64(picked_cnt) / pick_secs) << "},\n";
+
+    //-----------------------------------------------------------------------
+    // Slot pattern queries.  Each pattern keeps two letters of a real word.
+    //-----------------------------------------------------------------------
+    std::string subject = path.substr( 0, path.length() - 4 );     // drop .txt
+    uint64_t  load_allocs = alloc_cnt;
+    Corpus *  corpus      = Corpus::get( subject, false, false );
+    load_allocs = alloc_cnt - load_allocs;
+    const WordTable& table = corpus->table;
+    WordList words( table );
+    start = clock_monotonic_time();
+    WordIndex index( words );
+    real64 index_secs = clock_monotonic_time() - start;
+
+    const uint32_t query_cnt = 2000;
+    std::vector<std::string> patterns;
+    for( uint32_t q = 0; q < query_cnt; q++ )
+    {
+        std::string_view word = words.word( rand_n( words.size() ) );
+        std::string pattern( word.length(), '-' );
+        for( uint32_t k = 0; k < 2; k++ )
+        {
+            uint32_t pos = rand_n( word.length() );
+            pattern[pos] = word[pos];
+        }
+        patterns.push_back( pattern );
+    }
+
+    uint64_t scan_hits = 0;
+    start = clock_monotonic_time();
+    for( const std::string& pattern: patterns )
+    {
+        for( uint32_t wi = 0; wi < words.size(); wi++ )
+        {
+            std::string_view word = words.word( wi );
+            if ( word.length() != pattern.length() ) continue;
+            bool ok = true;
+            for( uint32_t pos = 0; ok && pos < pattern.length(); pos++ ) ok = pattern[pos] == '-' || pattern[pos] == word[pos];
+            if ( ok ) scan_hits++;
+        }
+    }
+    real64 scan_secs = clock_monotonic_time() - start;
+
+    uint64_t index_hits = 0;
+    std::vector<uint32_t> word_ids;
+    start = clock_monotonic_time();
+    for( const std::string& pattern: patterns )
+    {
+        index.candidates( pattern, word_ids );
+        index_hits += word_ids.size();
+    }
+    real64 query_secs = clock_monotonic_time() - start;
+    dassert( scan_hits == index_hits, "index and scan disagree on pattern matches" );
+
+    std::cout << "\"pattern\": {\"word_cnt\": " << words.size() << ", \"index_build_secs\": " << index_secs <<
+                 ", \"scan_queries_per_sec\": " << uint64_t(query_cnt / scan_secs) <<
+                 ", \"index_queries_per_sec\": " << uint64_t(query_cnt / query_secs) <<
+                 ", \"speedup\": " << (scan_secs / query_secs) << "},\n";
+
+    //-----------------------------------------------------------------------
+    // Placement throughput: attempts (words tried, the -attempts budget) 
+    // and placements (words placed) per second.  Both scoring paths must 
+    // build the same grid.
+    //-----------------------------------------------------------------------
+    std::cout << "\"place\": [\n";
+    std::vector<uint32_t> place_sides = sides;
+    place_sides.push_back( 64 );
+    for( size_t si = 0; si < place_sides.size(); si++ )
+    {
+        uint32_t side = place_sides[si];
+        real64   secs[2];
+        uint32_t placed[2];
+        std::string grids[2];
+        for( uint32_t use_masks = 0; use_masks < 2; use_masks++ )
+        {
+            rand_thread_seed( seed );
+            Grid * grid = new Grid( side );
+            grid->use_masks = use_masks;
+            start = clock_monotonic_time();
+            grid->generate( words, attempts, 7, 50 );
+            secs[use_masks]   = clock_monotonic_time() - start;
+            placed[use_masks] = grid->placed_cnt;
+            grids[use_masks] = grid->grid;
+            delete grid;
+        }
+        dassert( grids[0] == grids[1], "bitboard and scalar scoring built different grids" );
+        std::cout << "    {\"side\": " << side << ", \"attempts\": " << attempts << ", \"words_placed\": " << placed[1] <<
+                     ", \"scalar_attempts_per_sec\": " << uint64_t(attempts / secs[0]) <<
+                     ", \"bitboard_attempts_per_sec\": " << uint64_t(attempts / secs[1]) <<
+                     ", \"scalar_placements_per_sec\": " << uint64_t(placed[0] / secs[0]) <<
+                     ", \"bitboard_placements_per_sec\": " << uint64_t(placed[1] / secs[1]) <<
+                     ", \"speedup\": " << (secs[0] / secs[1]) << "}" << ((si+1) < place_sides.size() ? "," : "") << "\n";
+    }
+    std::cout << "],\n";
+
+    // at side 64, a word down from the corner still leaves room for one across the whole top row
+    {
+        Grid  grid( 64 );
+        Clue  clue = {};
+        clue.word      = "ab";
+        clue.is_across = false;
+        grid.place( clue );
+        dassert( grid.origins( 0, 64, true ) == 1, "no slot for a word the length of a side 64 row" );
+    }
+
+    //-----------------------------------------------------------------------
+    // Fill density of the csp engine on generated patterns versus the 
+    // greedy engine, as gen_puz builds them (with the greedy fallback), 
+    // and how often the csp fill is complete.  At side 11, the csp engine 
+    // must fill at least as many cells on average; bigger grids mostly 
+    // fall back (see csp_fill()).  Pattern generation must give up once 
+    // its deadline has passed.
+    //-----------------------------------------------------------------------
+    std::cout << "\"fill\": [\n";
+    std::vector<uint32_t> fill_sides = { 11, 15, 21 };
+    for( size_t si = 0; si < fill_sides.size(); si++ )
+    {
+        Options  opt;
+        opt.side = fill_sides[si];
+        uint32_t fill_cnt = 8;
+        uint32_t complete_cnt = 0;
+        uint64_t filled[2] = { 0, 0 };         // greedy, csp
+        start = clock_monotonic_time();
+        for( uint32_t i = 0; i < fill_cnt; i++ )
+        {
+            for( uint32_t csp = 0; csp < 2; csp++ )
+            {
+                rand_thread_seed( seed + i );
+                Grid * grid = new Grid( opt.side );
+                CspStats stats;
+                if ( !csp || !csp_fill( *grid, opt, "", words, index, 0.0, stats ) ) {
+                    grid->generate( words, attempts, opt.larger_cutoff, opt.larger_pct );
+                }
+                complete_cnt += csp && stats.complete;
+                filled[csp]  += grid->filled_cnt;
+                delete grid;
+            }
+        }
+        real64 fill_secs = clock_monotonic_time() - start;
+        real64 cells = real64(fill_cnt) * opt.side * opt.side;
+        std::cout << "    {\"side\": " << opt.side << ", \"puzzles\": " << fill_cnt << 
+                     ", \"greedy_density\": " << (filled[0] / cells) << ", \"csp_density\": " << (filled[1] / cells) <<
+                     ", \"csp_complete\": " << complete_cnt << ", \"csp_complete_rate\": " << (real64(complete_cnt) / fill_cnt) << 
+                     ", \"secs\": " << fill_secs << "}" << ((si+1) < fill_sides.size() ? "," : "") << "\n";
+        if ( opt.side == 11 ) dassert( filled[1] >= filled[0], "csp fills fewer cells than greedy on average" );
+    }
+    std::cout << "],\n";
+    {
+        Options opt;
+        dassert( pattern_generate( 64, opt.symmetry, opt.block_pct, index, clock_monotonic_time() ) == "", "pattern_generate() ignores its deadline" );
+    }
+
+    //-----------------------------------------------------------------------
+    // ThreadPool for each thread count: submit() futures, parallel_for() 
+    // (also nested in a worker, and with every worker busy so only the 
+    // caller can run it), and shutdown() with tasks still queued.
+    //-----------------------------------------------------------------------
+    std::cout << "\"pool\": [\n";
+    for( size_t ti = 0; ti < threads.size(); ti++ )
+    {
+        ThreadPool pool( threads[ti] );
+        const uint64_t task_cnt = 100000;
+        std::vector<std::future<uint64_t>> futures;
+        futures.reserve( task_cnt );
+        start = clock_monotonic_time();
+        for( uint64_t i = 0; i < task_cnt; i++ ) futures.push_back( pool.submit( [i] { return i; } ) );
+        uint64_t sum = 0;
+        for( auto& f: futures ) sum += f.get();
+        real64 submit_secs = clock_monotonic_time() - start;
+        dassert( sum == task_cnt*(task_cnt-1)/2, "ThreadPool::submit() futures have the wrong sum" );
+
+        std::atomic<uint64_t> psum( 0 );
+        start = clock_monotonic_time();
+        pool.parallel_for( 0, task_cnt, [&]( uint64_t i ) { psum += i; }, 64 );
+        real64 for_secs = clock_monotonic_time() - start;
+        dassert( psum == task_cnt*(task_cnt-1)/2, "ThreadPool::parallel_for() missed or repeated iterations" );
+
+        std::atomic<uint64_t> nested( 0 );
+        auto outer = pool.submit( [&] 
+        {
+            pool.parallel_for( 0, 8, [&]( uint64_t ) { pool.parallel_for( 0, 100, [&]( uint64_t j ) { nested += j; } ); } );
+        } );
+        outer.get();
+        dassert( nested == 8*4950, "nested ThreadPool::parallel_for() in a worker missed iterations" );
+
+        std::atomic<uint32_t> blocked( 0 );
+        std::atomic<bool>     release( false );
+        std::vector<std::future<void>> blockers;
+        for( uint32_t w = 0; w < pool.thread_cnt(); w++ )
+        {
+            blockers.push_back( pool.submit( [&] { blocked++; while( !release ) std::this_thread::yield(); } ) );
+        }
+        while( blocked != pool.thread_cnt() ) std::this_thread::yield();
+        std::thread::id caller = std::this_thread::get_id();
+        std::atomic<uint64_t> by_caller( 0 );
+        pool.parallel_for( 0, 1000, [&]( uint64_t ) { by_caller += std::this_thread::get_id() == caller; } );
+        release = true;
+        for( auto& f: blockers ) f.get();
+        dassert( by_caller == 1000, "ThreadPool::parallel_for() did not run on the caller while the workers were busy" );
+
+        std::atomic<uint64_t> ran( 0 );
+        for( uint32_t i = 0; i < 1000; i++ ) pool.submit( [&] { ran++; } );
+        pool.shutdown();
+        dassert( ran == 1000, "ThreadPool::shutdown() dropped queued tasks" );
+
+        std::cout << "    {\"thread_cnt\": " << threads[ti] << ", \"submit_tasks_per_sec\": " << uint64_t(task_cnt / submit_secs) <<
+                     ", \"parallel_for_iters_per_sec\": " << uint64_t(task_cnt / for_secs) << "}" << 
+                     ((ti+1) < threads.size() ? "," : "") << "\n";
+    }
+    std::cout << "],\n";
+
+    //-----------------------------------------------------------------------
+    // End-to-end: gen_puz() for each side and thread count, written to
+    // /dev/null.  The subject was parsed once above, as in a batch.
+    //-----------------------------------------------------------------------
+    std::cout << "\"puzzles\": [\n";
+    for( size_t si = 0; si < sides.size(); si++ )
+    {
+        for( size_t ti = 0; ti < threads.size(); ti++ )
+        {
+            Options opt;
+            opt.subjects_s   = subject;
+            opt.side         = sides[si];
+            opt.thread_cnt   = threads[ti];
+            opt.attempts     = attempts;
+            opt.corpus_cache = false;
+            opt.out_path     = "/dev/null";
+            std::vector<real64> lat;
+            real64   total  = 0.0;
+            uint64_t allocs = alloc_cnt;
+            for( uint32_t i = 0; i < puzzles; i++ )
+            {
+                opt.seed  = seed + i;
+                opt.title = "";
+                start = clock_monotonic_time();
+                gen_puz( opt, false );
+                real64 secs = clock_monotonic_time() - start;
+                lat.push_back( secs );
+                total += secs;
+            }
+            allocs = alloc_cnt - allocs;
+            bool last = (si+1) == sides.size() && (ti+1) == threads.size();
+            std::cout << "    {\"side\": " << opt.side << ", \"thread_cnt\": " << opt.thread_cnt << ", \"puzzles\": " << puzzles <<
+                         ", \"puzzles_per_sec\": " << (real64(puzzles) / total) <<
+                         ", \"p50_ms\": " << (percentile( lat, 50 ) * 1000.0) <<
+                         ", \"p99_ms\": " << (percentile( lat, 99 ) * 1000.0) << 
+                         ", \"allocs_per_puzzle\": " << (allocs / puzzles) << "}" << (last ? "" : ",") << "\n";
+        }
+    }
+    std::cout << "],\n";
+
+    //-----------------------------------------------------------------------
+    // -serve requests, without the socket: a good one, then bad ones that 
+    // must get an error reply rather than take the server down: options 
+    // that are not allowed or malformed, subjects given twice, and a 
+    // subject with no entries (also when repeated, which is the same set).
+    //-----------------------------------------------------------------------
+    {
+        std::string empty_path = "bench_empty.txt";
+        std::ofstream( empty_path ) << "# no entries\n";
+        Options defaults;
+        defaults.corpus_cache = false;
+        OutBuf   out;
+        uint32_t id = 0;
+        uint32_t served = 0;
+        if ( subject.find( '/' ) == std::string::npos ) {
+            dassert( serve_answer( defaults, subject + " -side 9 -seed 1 -id 7 -format ipuz", out, id ) && id == 7 && out.s.length() != 0,
+                     "-serve did not answer a good request" );
+            served++;
+        }
+        const std::vector<std::pair<std::string, std::string>> bad = {     // request, start of the error
+            { "bench_empty -attempts 5",                "option not allowed in a request: -attempts" },
+            { "bench_empty -side",                      "missing value for option -side" },
+            { "bench_empty -side 9x",                   "bad value for option -side" },
+            { "bench_empty -side -seed 1",              "bad value for option -side" },
+            { "bench_empty --side 9",                   "option not allowed in a request: --side" },
+            { "bench_empty bench_empty -side 9",        "subjects given twice" },
+            { "bench_empty -side 9 bench_empty",        "subjects given twice" },
+            { "bench_empty,,bench_empty",               "unknown subject" },
+            { "-side 9 -id 8",                          "no subjects given" },
+            { "bench_empty,bench_empty,bench_empty",    "no entries in bench_empty" },
+            { "bench_empty -side 9 -id 8",              "no entries in bench_empty" },
+        };
+        for( const auto& b: bad )
+        {
+            dassert( !serve_answer( defaults, b.first, out, id ) && out.s.compare( 0, b.second.length(), b.second ) == 0,
+                     "-serve request '" + b.first + "' got: " + out.s );
+        }
+        dassert( id == 8, "-serve did not return the -id of a rejected request" );
+        dassert( Corpus::get( "bench_empty", true, false, 1 ) == nullptr, "Corpus::get() went past its cache_max" );
+        std::cout << "\"serve\": {\"answered\": " << served << ", \"rejected\": " << bad.size() << "},\n";
+        unlink( empty_path.c_str() );
+    }
+
+    std::cout << "\"memory\": {\"entry_cnt\": " << table.entries.size() << ", \"word_cnt\": " << table.words.size() <<
+                 ", \"word_record_bytes\": " << sizeof(Word) << ", \"word_table_bytes\": " << table.bytes() <<
+                 ", \"load_allocs\": " << load_allocs << ", \"peak_rss_kb\": " << peak_rss_kb() << "}\n";
+    std::cout << "}\n";
+    unlink( path.c_str() );
+    return 0;
+}
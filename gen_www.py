@@ -71,7 +71,7 @@ while i < len( sys.argv ):
     else:
         die( f'unknown option: {arg}' )
 
-cmd( f'rm -f www/*.html' )
+cmd( f'rm -f www/index.html www/*.ipuz www/*_r[01].html' )
 cmd( f'make gen_puz' )
 
 s = ''
@@ -102,36 +102,66 @@ s += f'<body>\n'
 s += f'<h3><a href="https://www.imustcook.com">Click here for some Italian food recipes (because words are not enough)</a></h3>'
 
 #-----------------------------------------------------------------------
-# Generate the individual puzzles.
+# Write a manifest with one line per puzzle and generate them all
+# with one gen_puz process, so each subject file is parsed only once.
+# Each puzzle is a data-only .ipuz file played by www/player.html.
+# Puzzles already in puz_cache/ are copied from there instead of rebuilt.
 #-----------------------------------------------------------------------
+manifest = ''
 all_s = ''
 for subject_info in subjects:
     subject   = subject_info[0]
-    color     = subject_info[1]
     do_recent = subject_info[2]
-    s += f'<section style="clear: left">\n'
-    s += f'<br>\n'
     subjects_s = all_s if subject == 'all_lists' else subject
-    entry_cnt = int( cmd( f'./gen_puz {subjects_s} -print_entry_cnt_and_exit 1' ) )
+    subject_info.append( subjects_s )
+    subject_info.append( [] )
+    manifest += f'{subjects_s} -print_entry_cnt_and_exit 1\n'
     if subject != 'all_lists':
-        s += f'<h2><a href="https://github.com/balfieri/study/blob/master/{subject}.txt">{subject}</a> ({entry_cnt} entries)</h2>'
         if all_s != '': all_s += ','
         all_s += subject
-    else:
-        s += f'<h2>{subject} ({entry_cnt} entries)</h2>'
     for reverse in range(2):
-        clue_lang = 'Italian' if reverse == 0 else 'English'
         for recent in range(2):
             if recent and not do_recent: continue
-            recency = f'most recent entries' if recent else f'all entries'
             start_pct = 85 if recent else 0
-            s += f'<section style="clear: left">\n'
-            s += f'<b>{clue_lang} ({recency}):</b><br>'
+            titles = []
             for i in range(count):
                 title = f'{subject}_s{seed}_r{reverse}'
-                cmd( f'./gen_puz {subjects_s} -side {side} -seed {seed} -reverse {reverse} -start_pct {start_pct} -title {title} > www/{title}.html' )
+                manifest += f'{subjects_s} -side {side} -seed {seed} -reverse {reverse} -start_pct {start_pct} -title {title} -format ipuz -o www/{title}.ipuz\n'
                 seed += 1
-                s += f'<a href="{title}.html"><div class="rectangle" style="background-color: {color}">{i}</div></a>\n'
+                titles.append( title )
+            subject_info[4].append( [reverse, recent, titles] )
+
+file = open( "www/manifest.txt", "w" )
+file.write( manifest )
+file.close()
+
+entry_cnts = {}
+for line in cmd( f'./gen_puz -batch www/manifest.txt -cache_dir puz_cache' ).splitlines():
+    fields = line.split()
+    if len( fields ) == 2: entry_cnts[fields[0]] = int(fields[1])
+cmd( f'rm -f www/manifest.txt' )
+
+#-----------------------------------------------------------------------
+# Link to the individual puzzles.
+#-----------------------------------------------------------------------
+for subject_info in subjects:
+    subject    = subject_info[0]
+    color      = subject_info[1]
+    subjects_s = subject_info[3]
+    s += f'<section style="clear: left">\n'
+    s += f'<br>\n'
+    entry_cnt = entry_cnts.get( subjects_s, 0 )
+    if subject != 'all_lists':
+        s += f'<h2><a href="https://github.com/balfieri/study/blob/master/{subject}.txt">{subject}</a> ({entry_cnt} entries)</h2>'
+    else:
+        s += f'<h2>{subject} ({entry_cnt} entries)</h2>'
+    for reverse, recent, titles in subject_info[4]:
+        clue_lang = 'Italian' if reverse == 0 else 'English'
+        recency = f'most recent entries' if recent else f'all entries'
+        s += f'<section style="clear: left">\n'
+        s += f'<b>{clue_lang} ({recency}):</b><br>'
+        for i in range(len(titles)):
+            s += f'<a href="player.html?p={titles[i]}"><div class="rectangle" style="background-color: {color}">{i}</div></a>\n'
 
 s += f'<section style="clear: left">\n'
 s += '<br>\n'
@@ -0,0 +1,3732 @@
+// Copyright (c) 2022-2023 Robert A. Alfieri
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// puz.h - crossword puzzle data structures and generator
+//
+// This header provides:
+// - reading subject files into entries and picking answer words
+// - corpus images cached on disk
+// - indexing words by (length, position, letter)
+// - filling a grid and writing it out
+// - filling a block pattern by constraint satisfaction (-engine csp)
+// - options and batch generation
+//
+// It is shared by gen_puz.cpp and bench_puz.cpp.
+//
+#ifndef PUZH
+#define PUZH
+
+#include "sys.h"                // common utility functions
+
+#include <string_view>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <zlib.h>
+
+// <=3 letter words are already excluded
+// these are common words with more then 3 letters to excluded
+const std::map<std::string, bool> common_words = { 
+     {"avere", true}, 
+     {"averla", true},
+     {"averlo", true},
+     {"averle", true},
+     {"averli", true},
+     {"aver", true},
+     {"essere", true}, 
+     {"esserla", true}, 
+     {"esserlo", true}, 
+     {"esserle", true}, 
+     {"esserli", true}, 
+     {"stare", true},
+     {"stai", true},
+     {"stiamo", true},
+     {"state", true},
+     {"stanno", true},
+     {"fare", true}, 
+     {"farla", true},
+     {"farlo", true},
+     {"farle", true},
+     {"farli", true},
+     {"farsi", true},
+     {"dare", true},
+     {"come", true},
+//   {"così", true},
+     {"cos4", true},    // transformed
+     {"sono", true}, 
+     {"miei", true},
+     {"tuoi", true},
+     {"suoi", true},
+     {"vuoi", true},
+     {"dall", true},
+     {"dalla", true},
+     {"dallo", true},
+     {"dagli", true}, 
+     {"dalle", true}, 
+     {"dell", true},
+     {"della", true},
+     {"dello", true},
+     {"degli", true}, 
+     {"delle", true}, 
+     {"nell", true},
+     {"nella", true},
+     {"nello", true},
+     {"negli", true}, 
+     {"nelle", true}, 
+     {"sull", true},
+     {"sugli", true},
+     {"sulla", true},
+     {"sullo", true},
+     {"sulle", true},
+     {"all", true},
+     {"alla", true},
+     {"allo", true},
+     {"alle", true},
+     {"agli", true},
+     {"cosa", true},
+     {"cose", true},
+     {"anno", true},
+     {"anni", true},
+     {"mese", true},
+     {"mesi", true},
+     {"idea", true},
+     {"idee", true},
+     {"area", true},
+     {"golf", true},
+     {"ieri", true},
+     {"ecco", true},
+     {"vita", true},
+     {"sole", true},
+     {"tuba", true},
+     {"film", true},
+
+     {"than", true},
+     {"each", true},
+     {"with", true},
+     {"does", true},
+     {"doesn", true},
+     {"must", true},
+     {"here", true},
+     {"bass", true},
+     {"take", true},
+     {"away", true},
+     {"club", true},
+};
+
+//-----------------------------------------------------------------------
+// Read a line from a file w/o newline and return it as a string.
+// Return "" if nothing else in the file.
+//-----------------------------------------------------------------------
+inline std::string readline( std::ifstream& in )
+{
+    std::string s = "";
+    while( !in.eof() ) 
+    {
+        char c;
+        if ( !in.get( c ) ) break;
+        s += c;
+        if ( c == '\n' ) break;
+    }
+    return s;
+}
+
+//-----------------------------------------------------------------------
+// Read a whole file into a string with one read().
+//-----------------------------------------------------------------------
+inline void file_read( std::string path, std::string& s )
+{
+    int fd = open( path.c_str(), O_RDONLY );
+    dassert( fd >= 0, "could not open file " + path + " for input" );
+    struct stat st;
+    dassert( fstat( fd, &st ) == 0, "could not stat file " + path );
+    s.resize( st.st_size );
+    size_t got = 0;
+    while( got < s.length() )
+    {
+        ssize_t ret = read( fd, &s[got], s.length() - got );
+        dassert( ret > 0, "could not read file " + path + " errno=" + errno_str() );
+        got += ret;
+    }
+    close( fd );
+}
+
+//-----------------------------------------------------------------------
+// File times from a struct stat, in nanoseconds since the epoch.
+//-----------------------------------------------------------------------
+inline uint64_t file_mtime_ns( const struct stat& st )
+{
+#ifdef __APPLE__
+    return uint64_t( st.st_mtimespec.tv_sec ) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    return uint64_t( st.st_mtim.tv_sec ) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+inline uint64_t file_ctime_ns( const struct stat& st )
+{
+#ifdef __APPLE__
+    return uint64_t( st.st_ctimespec.tv_sec ) * 1000000000 + st.st_ctimespec.tv_nsec;
+#else
+    return uint64_t( st.st_ctim.tv_sec ) * 1000000000 + st.st_ctim.tv_nsec;
+#endif
+}
+
+//-----------------------------------------------------------------------
+// Output buffer with the << of an ostream for the types the writers use.
+// A whole document is built in it and then written with one write().
+// clear() keeps the memory, so one buffer can be reused for many documents.
+//-----------------------------------------------------------------------
+class OutBuf
+{
+public:
+    std::string s;
+
+    inline void    clear( void )                        { s.clear(); }
+    inline OutBuf& operator << ( std::string_view v )   { s.append( v.data(), v.length() ); return *this; }
+    inline OutBuf& operator << ( const char * v )       { s.append( v ); return *this; }
+    inline OutBuf& operator << ( char c )               { s.push_back( c ); return *this; }
+    inline OutBuf& operator << ( uint32_t v )           { return *this << uint64_t( v ); }
+    OutBuf&        operator << ( uint64_t v );
+
+    void write_fd( int fd, std::string what ) const;
+    void write_file( std::string path ) const;
+    void gzip( const OutBuf& in, int level );   // replace contents with in compressed in gzip format
+};
+
+OutBuf& OutBuf::operator << ( uint64_t v )
+{
+    char   digits[20];
+    size_t n = 0;
+    do 
+    {
+        digits[n++] = '0' + (v % 10);
+        v /= 10;
+    } while( v != 0 );
+    while( n != 0 ) s.push_back( digits[--n] );
+    return *this;
+}
+
+// what is used in error messages
+void OutBuf::write_fd( int fd, std::string what ) const
+{
+    size_t done = 0;
+    while( done < s.length() )
+    {
+        ssize_t ret = ::write( fd, s.data() + done, s.length() - done );
+        dassert( ret > 0, "could not write " + what + " errno=" + errno_str() );
+        done += ret;
+    }
+}
+
+void OutBuf::write_file( std::string path ) const
+{
+    int fd = open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    dassert( fd >= 0, "could not open file " + path + " for output" );
+    write_fd( fd, "file " + path );
+    dassert( close( fd ) == 0, "could not write file " + path + " errno=" + errno_str() );
+}
+
+//-----------------------------------------------------------------------
+// The gzip header has no name and a zero mtime, so the same input 
+// always gives the same bytes.  Level is 1 (fastest) to 9 (smallest).
+//-----------------------------------------------------------------------
+void OutBuf::gzip( const OutBuf& in, int level )
+{
+    z_stream zs;
+    memset( &zs, 0, sizeof(zs) );
+    dassert( deflateInit2( &zs, level, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY ) == Z_OK, "could not initialize zlib deflate" );
+    s.resize( deflateBound( &zs, in.s.length() ) );
+    zs.next_in   = reinterpret_cast<Bytef *>( const_cast<char *>( in.s.data() ) );
+    zs.avail_in  = in.s.length();
+    zs.next_out  = reinterpret_cast<Bytef *>( &s[0] );
+    zs.avail_out = s.length();
+    dassert( deflate( &zs, Z_FINISH ) == Z_STREAM_END, "zlib deflate did not finish" );
+    s.resize( zs.total_out );
+    deflateEnd( &zs );
+}
+
+//-----------------------------------------------------------------------
+// Trim leading and/or trailing whitespace from a view (same characters as \s).
+//-----------------------------------------------------------------------
+inline bool is_space( char ch )
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\v' || ch == '\f';
+}
+
+inline std::string_view trim_left( std::string_view s )
+{
+    size_t i = 0;
+    while( i < s.length() && is_space( s[i] ) ) i++;
+    return s.substr( i );
+}
+
+inline std::string_view trim( std::string_view s )
+{
+    s = trim_left( s );
+    size_t len = s.length();
+    while( len > 0 && is_space( s[len-1] ) ) len--;
+    return s.substr( 0, len );
+}
+
+//-----------------------------------------------------------------------
+// Quote a string for JSON.  Bytes >= 0x80 (UTF-8) pass through.
+//-----------------------------------------------------------------------
+inline std::string json_str( std::string_view s )
+{
+    std::string r = "\"";
+    for( char ch: s )
+    {
+        switch( ch )
+        {
+            case '"':  r += "\\\""; break;
+            case '\\': r += "\\\\"; break;
+            case '\n': r += "\\n";  break;
+            case '\r': r += "\\r";  break;
+            case '\t': r += "\\t";  break;
+            default:
+                if ( uint8_t(ch) < 0x20 ) {
+                    char buf[8];
+                    snprintf( buf, sizeof(buf), "\\u%04x", uint8_t(ch) );
+                    r += buf;
+                } else {
+                    r += ch;
+                }
+                break;
+        }
+    }
+    r += "\"";
+    return r;
+}
+
+//-----------------------------------------------------------------------
+// Convert UTF-8 to ISO-8859-1 (Latin-1), the code page of .puz files.
+// The typographic apostrophe becomes ' and anything else outside 
+// Latin-1 becomes ?.
+//-----------------------------------------------------------------------
+inline std::string latin1_str( std::string_view s )
+{
+    std::string r;
+    size_t len = s.length();
+    for( size_t i = 0; i < len; i++ )
+    {
+        uint8_t ch = s[i];
+        if ( ch < 0x80 ) {
+            r += char(ch);
+        } else if ( (ch == 0xc2 || ch == 0xc3) && (i+1) < len ) {
+            r += char( ((ch & 0x03) << 6) | (uint8_t(s[++i]) & 0x3f) );
+        } else if ( ch == 0xe2 && (i+2) < len && s[i+1] == '\x80' && s[i+2] == '\x99' ) {
+            r += '\'';
+            i += 2;
+        } else {
+            r += '?';
+            while( (i+1) < len && (uint8_t(s[i+1]) & 0xc0) == 0x80 ) i++;     // skip continuation bytes
+        }
+    }
+    return r;
+}
+
+//-----------------------------------------------------------------------
+// Pull out all interesting answer words and put them into an array, 
+// with a reference back to the original question.
+//-----------------------------------------------------------------------
+class PickedWord
+{
+public:
+    std::string         word;
+    uint32_t            pos;                    // in answer
+    uint32_t            pos_last;               // in answer
+
+    inline PickedWord( std::string word, uint32_t pos, uint32_t pos_last ) : word(word), pos(pos), pos_last(pos_last) {}
+};
+
+void pick_words( std::string_view a, std::vector<PickedWord>& words )
+{
+    words.clear();
+    std::string word = "";
+    uint32_t    word_pos = 0;
+    bool        in_parens = false;
+    size_t      a_len = a.length();
+    for( size_t i = 0; i < a_len; i++ )
+    {
+        char ch = a[i];
+        if ( ch == ' ' || ch == '\t' || ch == '\'' || ch == '\'' || ch == '/' || ch == '(' || ch == ')' || 
+             ch == '!' || ch == '?' || ch == '.' || ch == ',' || ch == '-' || ch == ':' || ch == '"' || ch == '[' || ch == ']' || 
+             ch == '0' || ch == '1' || ch == '2' || ch == '3' || ch == '4' || ch == '5' || ch == '6' || ch == '7' || ch == '8' || ch == '9' ||
+             ch == '\xe2' ) {
+            if ( word != "" ) {
+                if ( !in_parens ) {
+                    words.push_back( PickedWord( word, word_pos, i-1 ) );
+                }
+                word = "";
+            }
+            if ( ch == '\xe2' ) {
+                ch = a[++i];
+                dassert( ch == '\x80', "did not get 0x80 after 0xe2 for quote" );
+                ch = a[++i];
+                dassert( ch == '\x99', "did not get 0x99 after 0xe2 0x80 for quote" );
+            } else if ( ch == '(' ) {
+                dassert( !in_parens, "cannot support nested parens" );
+                in_parens = true;
+            } else if ( ch == ')' ) {
+                dassert( in_parens, "no matching left paren" );
+                in_parens = false;
+            }
+        } else if ( !in_parens ) {
+            if ( word == "" ) word_pos = i;
+            if ( ch != '\xc3' ) {
+                // not 16-bit char
+                if ( ch >= 'A' && ch <= 'Z' ) {
+                    ch = 'a' + ch - 'A';
+                }
+                if ( ch < 'a' || ch > 'z' ) {
+                    for( size_t ii = 0; ii < a_len; ii++ )
+                    {
+                        ch = a[ii];
+                        std::cout << ii << ": " << std::string( 1, ch ) << " (0x" << std::hex << int(uint8_t(ch)) << std::dec << ")\n";
+                    }
+                    exit( 1 );
+                }
+                word += ch;
+            } else {
+                // 16-bit char
+                // allowed: àáèéìíòóùú
+                dassert( i < (a_len-1), "incomplete special character in answer: " + std::string( a ) );
+                ch = a[++i];
+                if ( uint8_t(ch) >= 0x80 && uint8_t(ch) <= 0x9f ) {
+                    ch = 0xa0 + ch - 0x80;              // make lower-case
+                }
+
+                // Map these characters to 0..9 so we use only one byte to represent them,
+                // which will make creation of the puzzle much easier.
+                // When we go to write out the puzzle, we'll these characters back.
+                switch( ch )
+                {
+                    case '\xa0': ch = '0'; break;
+                    case '\xa1': ch = '1'; break;
+                    case '\xa8': ch = '2'; break;
+                    case '\xa9': ch = '3'; break;
+                    case '\xac': ch = '4'; break;
+                    case '\xad': ch = '5'; break;
+                    case '\xb2': ch = '6'; break;
+                    case '\xb3': ch = '7'; break;
+                    case '\xb9': ch = '8'; break;
+                    case '\xba': ch = '9'; break;
+                    default:     die( "bad special character in answer:" + std::string( a ) ); break;
+                }
+                word += ch;
+            }
+        }
+    }
+    if ( word != "" ) {
+        words.push_back( PickedWord( word, word_pos, a_len-1 ) );
+    }
+}
+
+//-----------------------------------------------------------------------
+// Entries are the question/answer pairs read from the subject files.
+// Words are the interesting answer words picked from the entries.
+// Clues are words that have been placed in the grid.
+//
+// The entry strings are views into the corpus image of the subject file
+// (see Subject below), which stays in memory for the whole run.
+// Words are fixed-width records kept in a WordTable (see below).
+//-----------------------------------------------------------------------
+struct Entry 
+{
+    std::string_view    q;
+    std::string_view    a;
+    uint32_t            word_first;             // words picked from this entry, as WordTable word ids
+    uint32_t            word_cnt;
+};
+
+struct Word
+{
+    uint32_t            off;                    // letters in WordTable::letters
+    uint32_t            len;
+    uint32_t            entry;                  // WordTable entry id
+    uint32_t            answer;                 // WordTable answer id (the ';'-separated answer that holds the word)
+    uint32_t            pos;                    // first and last byte of the word in the answer
+    uint32_t            pos_last;
+};
+
+struct Clue
+{
+    std::string_view    word;
+    uint32_t            pos;
+    uint32_t            pos_last;
+    std::string_view    a;
+    const Entry *       entry;
+    uint32_t            x;
+    uint32_t            y;
+    bool                is_across;
+    uint32_t            num;
+};
+
+//-----------------------------------------------------------------------
+// The entries, answers and words of a corpus.  The letters of all words
+// are in one arena, back to back (a word is its offset and length).  Words 
+// are grouped by entry, in entry order.
+//-----------------------------------------------------------------------
+class WordTable
+{
+public:
+    std::vector< Entry >            entries;
+    std::vector< std::string_view > answers;
+    std::vector< Word >             words;      // grouped by entry, in entry order
+    std::string                     letters;
+
+    void add_word( std::string_view word, uint32_t answer, uint32_t pos, uint32_t pos_last );
+    void finish( void );                        // after the last add_word()
+    size_t bytes( void ) const;                 // memory used, not counting the corpus images
+};
+
+// the word goes with the last entry added
+void WordTable::add_word( std::string_view word, uint32_t answer, uint32_t pos, uint32_t pos_last )
+{
+    Word w;
+    w.off      = letters.length();
+    w.len      = word.length();
+    w.entry    = entries.size() - 1;
+    w.answer   = answer;
+    w.pos      = pos;
+    w.pos_last = pos_last;
+    words.push_back( w );
+    entries.back().word_cnt++;
+    letters.append( word.data(), word.length() );
+}
+
+void WordTable::finish( void )
+{
+    answers.shrink_to_fit();
+    words.shrink_to_fit();
+    letters.shrink_to_fit();
+}
+
+size_t WordTable::bytes( void ) const
+{
+    return entries.capacity()*sizeof(Entry) + answers.capacity()*sizeof(std::string_view) + 
+           words.capacity()*sizeof(Word) + letters.capacity();
+}
+
+//-----------------------------------------------------------------------
+// The words that one puzzle is filled from: a view of the words of a range 
+// of entries in a WordTable.  Since the table keeps the words grouped by 
+// entry, any range is one contiguous span, found in O(1) from the first and last Entry.
+// The fill code (WordIndex, WordSampler, Grid, CspFill) uses indexes into 
+// this list as word ids.
+//-----------------------------------------------------------------------
+class WordList
+{
+public:
+    const WordTable *   table;
+    const Word *        words;
+    uint32_t            word_cnt;
+
+    WordList( const WordTable& table );                                                 // all entries
+    WordList( const WordTable& table, uint32_t entry_first, uint32_t entry_last );      // entries first..last
+
+    inline uint32_t         size( void ) const                  { return word_cnt; }
+    inline const Word *     begin( void ) const                 { return words; }
+    inline const Word *     end( void ) const                   { return words + word_cnt; }
+    inline const Word&      operator [] ( uint32_t wi ) const   { return words[wi]; }
+    inline const char *     letters( uint32_t wi ) const        { return table->letters.data() + words[wi].off; }
+    inline std::string_view word( uint32_t wi ) const           { return std::string_view( letters( wi ), words[wi].len ); }
+    inline const Entry&     entry( uint32_t wi ) const          { return table->entries[words[wi].entry]; }
+    void                    clue( uint32_t wi, Clue& clue ) const;
+};
+
+WordList::WordList( const WordTable& table ) : table(&table), words(table.words.data()), word_cnt(table.words.size())
+{
+}
+
+WordList::WordList( const WordTable& table, uint32_t entry_first, uint32_t entry_last ) : table(&table)
+{
+    dassert( entry_first <= entry_last && entry_last < table.entries.size(), "bad entry range for WordList" );
+    const Entry& first = table.entries[entry_first];
+    const Entry& last  = table.entries[entry_last];
+    words    = table.words.data() + first.word_first;
+    word_cnt = last.word_first + last.word_cnt - first.word_first;
+}
+
+// fill in the word part of a clue; the caller fills in the location
+void WordList::clue( uint32_t wi, Clue& clue ) const
+{
+    const Word& w = words[wi];
+    clue.word     = word( wi );
+    clue.pos      = w.pos;
+    clue.pos_last = w.pos_last;
+    clue.a        = table->answers[w.answer];
+    clue.entry    = &table->entries[w.entry];
+}
+
+//-----------------------------------------------------------------------
+// Split the text of a subject file into entries.  Each entry is a 
+// question line followed by an answer line.  Blank lines and lines starting 
+// with '#' are skipped.  Lines are trimmed in place, so the entries are views 
+// into text.  Their words are filled in later.
+//-----------------------------------------------------------------------
+void parse_subject( std::string_view text, std::vector<Entry>& entries )
+{
+    entries.clear();
+    const char * s     = text.data();
+    size_t       len   = text.length();
+    size_t       pos   = 0;
+    auto next_line = [&]( std::string_view& line ) -> bool
+    {
+        if ( pos >= len ) return false;
+        const char * start = s + pos;
+        const char * nl    = reinterpret_cast<const char *>( memchr( start, '\n', len - pos ) );
+        size_t line_len    = (nl != nullptr) ? (nl - start) : (len - pos);
+        line = std::string_view( start, line_len );
+        pos += line_len + ((nl != nullptr) ? 1 : 0);
+        return true;
+    };
+
+    uint32_t line_num = 0;
+    std::string_view question;
+    while( next_line( question ) )
+    {
+        line_num++;
+        question = trim( question );
+        if ( question.length() == 0 or question[0] == '#' ) continue;
+
+        std::string_view answer;
+        if ( next_line( answer ) ) answer = trim( answer );
+        dassert( answer.length() != 0, "question on line " + std::to_string(line_num) + " is not followed by a non-blank answer on the next line: " + std::string( question ) );
+        line_num++;
+
+        Entry entry;
+        entry.q          = question;
+        entry.a          = answer;
+        entry.word_first = 0;
+        entry.word_cnt   = 0;
+        entries.push_back( entry );
+    }
+}
+
+//-----------------------------------------------------------------------
+// Index of the words by (length, position, letter).
+//
+// Letters are the 26 lower-case letters plus the accented letters that
+// pick_words() maps to '0'..'9'.  For each word length there is one bitset 
+// over the words of that length per (position, letter).  A slot pattern 
+// such as "-a--o--" ('-' means any letter) is answered by ANDing the 
+// bitsets of its fixed letters.  Word ids are indexes into the words array 
+// the index was built from.
+//-----------------------------------------------------------------------
+class WordIndex
+{
+public:
+    static const uint32_t LETTER_CNT = 36;
+
+    static inline uint32_t letter_code( char ch ) { return (ch >= 'a' && ch <= 'z') ? (ch - 'a') : (26 + ch - '0'); }
+
+    WordIndex( const WordList& words );
+
+    uint32_t max_len( void ) const { return len_words.size() - 1; }
+    uint32_t word_cnt( uint32_t len ) const { return (len < len_words.size()) ? len_words[len].size() : 0; }
+
+    void     candidates( std::string_view pattern, std::vector<uint32_t>& word_ids ) const;
+    uint32_t candidate_cnt( std::string_view pattern ) const;
+
+private:
+    std::vector< std::vector<uint32_t> > len_words;     // [len] -> word ids of that length
+    std::vector< size_t >                len_bits;      // [len] -> first bitset word in bits
+    std::vector< uint64_t >              bits;
+
+    inline uint32_t chunk_cnt( uint32_t len ) const { return (len_words[len].size() + 63) / 64; }
+    inline const uint64_t * bitset( uint32_t len, uint32_t pos, uint32_t code ) const 
+    { 
+        return bits.data() + len_bits[len] + (size_t(pos)*LETTER_CNT + code) * chunk_cnt( len ); 
+    }
+    uint32_t intersect( std::string_view pattern, std::vector<uint64_t>& acc ) const;
+};
+
+WordIndex::WordIndex( const WordList& words )
+{
+    uint32_t len_max = 0;
+    for( const Word& w: words ) len_max = std::max( len_max, w.len );
+    len_words.resize( len_max+1 );
+    for( uint32_t wi = 0; wi < words.size(); wi++ )
+    {
+        len_words[words[wi].len].push_back( wi );
+    }
+
+    len_bits.resize( len_max+1 );
+    size_t total = 0;
+    for( uint32_t len = 0; len <= len_max; len++ )
+    {
+        len_bits[len] = total;
+        total += size_t(len) * LETTER_CNT * chunk_cnt( len );
+    }
+    bits.resize( total, 0 );
+    for( uint32_t len = 0; len <= len_max; len++ )
+    {
+        uint32_t chunks = chunk_cnt( len );
+        for( uint32_t i = 0; i < len_words[len].size(); i++ )
+        {
+            const char * word = words.letters( len_words[len][i] );
+            for( uint32_t pos = 0; pos < len; pos++ )
+            {
+                uint64_t * b = bits.data() + len_bits[len] + (size_t(pos)*LETTER_CNT + letter_code( word[pos] )) * chunks;
+                b[i/64] |= uint64_t(1) << (i%64);
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------
+// AND together the bitsets for the fixed letters in the pattern.
+// Returns the number of fixed letters (0 means every word of that length).
+//-----------------------------------------------------------------------
+uint32_t WordIndex::intersect( std::string_view pattern, std::vector<uint64_t>& acc ) const
+{
+    uint32_t len    = pattern.length();
+    uint32_t chunks = chunk_cnt( len );
+    uint32_t fixed  = 0;
+    for( uint32_t pos = 0; pos < len; pos++ )
+    {
+        if ( pattern[pos] == '-' ) continue;
+        const uint64_t * b = bitset( len, pos, letter_code( pattern[pos] ) );
+        bool any = false;
+        if ( fixed == 0 ) {
+            acc.assign( b, b + chunks );
+            for( uint32_t c = 0; c < chunks; c++ ) any |= acc[c] != 0;
+        } else {
+            for( uint32_t c = 0; c < chunks; c++ ) 
+            {
+                acc[c] &= b[c];
+                any |= acc[c] != 0;
+            }
+        }
+        fixed++;
+        if ( !any ) break;      // nothing left
+    }
+    return fixed;
+}
+
+void WordIndex::candidates( std::string_view pattern, std::vector<uint32_t>& word_ids ) const
+{
+    word_ids.clear();
+    uint32_t len = pattern.length();
+    if ( len >= len_words.size() ) return;
+    const std::vector<uint32_t>& lw = len_words[len];
+    std::vector<uint64_t> acc;
+    if ( intersect( pattern, acc ) == 0 ) {
+        word_ids = lw;
+        return;
+    }
+    for( uint32_t c = 0; c < acc.size(); c++ )
+    {
+        for( uint64_t b = acc[c]; b != 0; b &= b-1 )
+        {
+            word_ids.push_back( lw[c*64 + __builtin_ctzll( b )] );
+        }
+    }
+}
+
+uint32_t WordIndex::candidate_cnt( std::string_view pattern ) const
+{
+    uint32_t len = pattern.length();
+    if ( len >= len_words.size() ) return 0;
+    std::vector<uint64_t> acc;
+    if ( intersect( pattern, acc ) == 0 ) return len_words[len].size();
+    uint32_t cnt = 0;
+    for( uint64_t b: acc ) cnt += __builtin_popcountll( b );
+    return cnt;
+}
+
+//-----------------------------------------------------------------------
+// Optional counters for the hot paths and times for each phase.
+// They are compiled in only with -DPUZ_COUNTERS, for example:
+//
+//     make EXTRA_CFLAGS=-DPUZ_COUNTERS
+//
+// Otherwise puz_count(...) expands to nothing and costs nothing.
+// Each Grid counts its own attempts (one Grid per thread) and gen_puz()
+// adds them into puz_counters, which also holds the phase times.
+//-----------------------------------------------------------------------
+#ifdef PUZ_COUNTERS
+#define puz_count( ... ) __VA_ARGS__
+#else
+#define puz_count( ... )
+#endif
+
+struct PuzCounters
+{
+    // Grid::generate() attempts
+    uint64_t    attempt_cnt;                    // words drawn by the attempts loop
+    uint64_t    rejected_entry_used_cnt;        // word's entry is already in the grid
+    uint64_t    scored_cnt;                     // word was scored everywhere
+    uint64_t    placed_cnt;                     // word was placed
+
+    // Grid::find_best(), also called by optimize()
+    uint64_t    cell_cnt;                       // cells inspected while scoring
+    uint64_t    early_break_cnt;                // placements or lines given up before the last cell
+
+    // phase times in milliseconds
+    real64      load_ms;                        // reading or mapping corpora
+    real64      trim_ms;                        // parse_subject()
+    real64      pick_words_ms;                  // pick_words()
+    real64      placement_ms;                   // generate(), optimize() or csp fill, all threads
+    real64      numbering_ms;                   // Grid::number()
+    real64      output_ms;                      // the rest of Grid::write()
+
+    PuzCounters( void ) { clear(); }
+    void clear( void ) { *this = PuzCounters( 0 ); }
+    void add_attempts( const PuzCounters& other );
+    void print( std::ostream& out, std::string title ) const;
+
+private:
+    PuzCounters( int ) : attempt_cnt(0), rejected_entry_used_cnt(0), scored_cnt(0), placed_cnt(0), cell_cnt(0),
+                         early_break_cnt(0), load_ms(0), trim_ms(0), pick_words_ms(0),
+                         placement_ms(0), numbering_ms(0), output_ms(0) {}
+};
+
+PuzCounters puz_counters;                       // for the current puzzle
+
+void PuzCounters::add_attempts( const PuzCounters& other )
+{
+    attempt_cnt             += other.attempt_cnt;
+    rejected_entry_used_cnt += other.rejected_entry_used_cnt;
+    scored_cnt              += other.scored_cnt;
+    placed_cnt              += other.placed_cnt;
+    cell_cnt                += other.cell_cnt;
+    early_break_cnt         += other.early_break_cnt;
+}
+
+void PuzCounters::print( std::ostream& out, std::string title ) const
+{
+    out << "counters: " << title <<
+           " attempts=" << attempt_cnt <<
+           " rejected_entry_used=" << rejected_entry_used_cnt <<
+           " scored=" << scored_cnt <<
+           " placed=" << placed_cnt <<
+           " cells=" << cell_cnt <<
+           " early_breaks=" << early_break_cnt << "\n";
+    out << "phases: " << title <<
+           " load_ms=" << load_ms <<
+           " trim_ms=" << trim_ms <<
+           " pick_words_ms=" << pick_words_ms <<
+           " placement_ms=" << placement_ms <<
+           " numbering_ms=" << numbering_ms <<
+           " output_ms=" << output_ms << "\n";
+}
+
+//-----------------------------------------------------------------------
+// Quality numbers for a filled grid (see Grid::stats()).
+//-----------------------------------------------------------------------
+struct GridStats
+{
+    uint32_t    across_cnt;                     // across words
+    uint32_t    down_cnt;                       // down words
+    uint32_t    letter_cnt;                     // sum of the word lengths
+    uint32_t    unchecked_cnt;                  // cells in only one word
+    uint32_t    entry_cnt;                      // distinct entries used
+};
+
+//-----------------------------------------------------------------------
+// Draws word ids at random without replacement, stratified by length.
+//
+// Word ids are bucketed by length with a counting sort.  Each bucket 
+// keeps its unused ids in front, so a draw is one step of a partial 
+// Fisher-Yates shuffle: pick one of the unused ids in the range of 
+// lengths, swap it with the last unused id of its bucket, and shrink 
+// the bucket.  Words longer than the grid are left out since they never fit.
+//-----------------------------------------------------------------------
+class WordSampler
+{
+public:
+    WordSampler( const WordList& words, uint32_t max_len );
+
+    uint32_t left( uint32_t min_len ) const;            // unused words of length >= min_len
+    bool     draw( uint32_t min_len, uint32_t& wi );    // false if there are none left
+
+private:
+    uint32_t                max_len;
+    std::vector<uint32_t>   ids;                        // word ids ordered by length
+    std::vector<uint32_t>   first;                      // [len] -> first id in ids
+    std::vector<uint32_t>   unused;                     // [len] -> ids still unused
+};
+
+WordSampler::WordSampler( const WordList& words, uint32_t max_len ) : max_len(max_len)
+{
+    first.resize( max_len+2, 0 );
+    unused.resize( max_len+1, 0 );
+    for( const Word& w: words )
+    {
+        if ( w.len <= max_len ) unused[w.len]++;
+    }
+    for( uint32_t len = 0; len <= max_len; len++ )
+    {
+        first[len+1] = first[len] + unused[len];
+    }
+    ids.resize( first[max_len+1] );
+    std::vector<uint32_t> next( first.begin(), first.end()-1 );
+    uint32_t word_cnt = words.size();
+    for( uint32_t wi = 0; wi < word_cnt; wi++ )
+    {
+        uint32_t len = words[wi].len;
+        if ( len <= max_len ) ids[next[len]++] = wi;
+    }
+}
+
+inline uint32_t WordSampler::left( uint32_t min_len ) const
+{
+    uint32_t cnt = 0;
+    for( uint32_t len = min_len; len <= max_len; len++ ) cnt += unused[len];
+    return cnt;
+}
+
+inline bool WordSampler::draw( uint32_t min_len, uint32_t& wi )
+{
+    uint32_t cnt = left( min_len );
+    if ( cnt == 0 ) return false;
+    uint32_t r   = rand_n( cnt );
+    uint32_t len = min_len;
+    while( r >= unused[len] ) r -= unused[len++];
+    uint32_t * bucket = &ids[first[len]];
+    uint32_t   last   = --unused[len];
+    wi = bucket[r];
+    bucket[r]    = bucket[last];
+    bucket[last] = wi;
+    return true;
+}
+
+//-----------------------------------------------------------------------
+// One puzzle grid and the algorithm that fills it.
+//-----------------------------------------------------------------------
+class Grid
+{
+public:
+    uint32_t    side;
+
+    //-----------------------------------------------------------------------
+    // Letters are kept in flat side*side buffers, '-' for an empty cell.
+    // grid and across_grid are by row (index y*side + x).  grid_t is grid 
+    // transposed and down_grid is by column (index x*side + y), so that 
+    // down scans also walk contiguous memory.
+    //-----------------------------------------------------------------------
+    std::string grid;                           // all letters, by row
+    std::string grid_t;                         // all letters, by column
+    std::string across_grid;                    // letters of across words, by row
+    std::string down_grid;                      // letters of down words, by column
+
+    inline char cell( uint32_t x, uint32_t y ) const { return grid[y*side + x]; }
+
+    //-----------------------------------------------------------------------
+    // The placed words, in no particular order, and where to find them
+    // by origin.  clue_order lists them by origin in y, x order; number() 
+    // fills it in.
+    //-----------------------------------------------------------------------
+    std::vector<Clue>       clues;
+    std::vector<int32_t>    clue_at;            // [(y*side + x)*2 + is_across] -> index in clues, -1 if none
+    std::vector<uint32_t>   clue_order;
+
+    inline const Clue * clue( uint32_t x, uint32_t y, bool is_across ) const 
+    { 
+        int32_t i = clue_at[(y*side + x)*2 + is_across];
+        return (i >= 0) ? &clues[i] : nullptr;
+    }
+
+    uint32_t    placed_cnt;                     // words placed
+    uint32_t    cross_cnt;                      // cells used by both an across and a down word
+    uint32_t    filled_cnt;                     // cells with a letter
+
+    //-----------------------------------------------------------------------
+    // Occupancy bitboards kept next to the letters when side <= 64.
+    // Bit x of row_occ[y] and bit y of col_occ[x] are set when cell x,y 
+    // has a letter.  across_occ/down_occ are the same for across_grid/down_grid.
+    // The scalar scoring code is used when use_masks is false; both give
+    // the same scores.
+    //-----------------------------------------------------------------------
+    bool                    use_masks;
+    std::vector<uint64_t>   row_occ;
+    std::vector<uint64_t>   col_occ;
+    std::vector<uint64_t>   across_occ;
+    std::vector<uint64_t>   down_occ;
+
+    //-----------------------------------------------------------------------
+    // Legal slot cache for the bitboards.  For each row (across) or column 
+    // (down) and each word length, the mask of origins where a word of that 
+    // length could be placed, ignoring its letters.  A placement changes only 
+    // the lines around it, so only those are recomputed.
+    //-----------------------------------------------------------------------
+    std::vector<uint64_t>   slot_origins;      // [(is_across*side + line)*(side+1) + len]
+
+    inline uint64_t origins( uint32_t line, uint32_t len, bool is_across ) const 
+    { 
+        return slot_origins[(uint32_t(is_across)*side + line)*(side+1) + len]; 
+    }
+
+    //-----------------------------------------------------------------------
+    // Inverted index from letter to the cells that hold it, kept as line masks.
+    // Bit x of letter_rows[code*side + y] and bit y of letter_cols[code*side + x] 
+    // are set when cell x,y holds the letter with that WordIndex::letter_code().
+    //-----------------------------------------------------------------------
+    std::vector<uint64_t>   letter_rows;
+    std::vector<uint64_t>   letter_cols;
+
+    Grid( uint32_t side );
+
+    bool        deadline_hit;                   // generate() or optimize() stopped at the deadline
+    mutable PuzCounters counters;               // only counted with -DPUZ_COUNTERS
+
+    // deadline is a clock_monotonic_time(), 0 means none
+    void     generate( const WordList& words, uint32_t attempts, uint32_t larger_cutoff, uint32_t larger_pct, real64 deadline=0.0 );
+    void     optimize( const WordList& words, uint32_t optimize_ms, std::string objective, real64 deadline=0.0 );
+    uint32_t objective_value( std::string objective ) const;
+    bool     is_better_than( const Grid& other ) const;
+    GridStats stats( void ) const;
+    void     number( void );
+    void     write( OutBuf& out, std::string title, bool html );
+    void     write_ipuz( OutBuf& out, std::string title );
+    void     write_puz( OutBuf& out, std::string title );
+    void     place( const Clue& clue );
+    void     remove( uint32_t x, uint32_t y, bool is_across );
+    bool     can_remove( uint32_t x, uint32_t y, bool is_across ) const;
+
+private:
+    std::vector<uint64_t>   across_origins;     // scratch for find_best(): [y] -> x origins
+    std::vector<uint64_t>   across_origins_t;   // [x] -> y origins
+    std::vector<uint64_t>   down_origins;       // [x] -> y origins
+
+    static void        write_solution_cell( OutBuf& out, char ch );
+    static std::string clue_text( const Clue& clue );
+    static uint16_t    puz_cksum( const char * data, size_t len, uint16_t cksum );
+
+    uint32_t score_across( uint32_t x, uint32_t y, const char * word, uint32_t word_len ) const;
+    uint32_t score_down( uint32_t x, uint32_t y, const char * word, uint32_t word_len ) const;
+    uint64_t candidates( uint32_t line, const char * word, uint32_t word_len, bool is_across ) const;
+    uint32_t find_best( const char * word, uint32_t word_len, Clue& best );
+    void     update_slots( uint32_t i, bool is_across );
+    void     update_slots_around( uint32_t x, uint32_t y, uint32_t word_len, bool is_across );
+};
+
+Grid::Grid( uint32_t side ) : side(side), placed_cnt(0), cross_cnt(0), filled_cnt(0), deadline_hit(false)
+{
+    grid        = std::string( side*side, '-' );
+    grid_t      = std::string( side*side, '-' );
+    across_grid = std::string( side*side, '-' );
+    down_grid   = std::string( side*side, '-' );
+    clue_at.resize( side*side*2, -1 );
+
+    use_masks = side <= 64;
+    if ( use_masks ) {
+        row_occ.resize( side, 0 );
+        col_occ.resize( side, 0 );
+        across_occ.resize( side, 0 );
+        down_occ.resize( side, 0 );
+        slot_origins.resize( 2*side*(side+1), 0 );
+        across_origins.resize( side );
+        across_origins_t.resize( side );
+        down_origins.resize( side );
+        letter_rows.resize( WordIndex::LETTER_CNT*side, 0 );
+        letter_cols.resize( WordIndex::LETTER_CNT*side, 0 );
+        for( uint32_t i = 0; i < side; i++ )
+        {
+            update_slots( i, true );
+            update_slots( i, false );
+        }
+    }
+}
+
+//-----------------------------------------------------------------------
+// Score the placement of a word across or down starting at x,y.
+// Edge rows/columns start at 5, others at 1, plus 1 for each letter 
+// that crosses an existing letter.  Returns 0 if the placement is illegal:
+//
+//     - a cell is already used by a word in the same direction
+//     - the cell before the first letter or after the last letter is used
+//     - a letter differs from the letter already in its cell
+//     - a letter goes in an empty cell that touches a letter on either side
+//-----------------------------------------------------------------------
+inline uint32_t Grid::score_across( uint32_t x, uint32_t y, const char * word, uint32_t word_len ) const
+{
+    uint32_t     score = (y == 0 || y == (side-1)) ? 5 : 1; 
+    const char * row   = &grid[y*side];
+    const char * used  = &across_grid[y*side];
+    for( uint32_t ci = 0; ci < word_len; ci++ ) 
+    {
+        puz_count( counters.cell_cnt++ );
+        if ( used[x+ci] != '-' ||
+             (ci == 0 && x > 0 && row[x-1] != '-') || 
+             (ci == (word_len-1) && (x+ci+1) < side && row[x+ci+1] != '-') ) {
+            puz_count( counters.early_break_cnt++ );
+            return 0;
+        }
+        char c  = word[ci];
+        char gc = row[x+ci];
+        if ( c == gc ) {
+            score++;
+        } else if ( gc != '-' ||
+                    (y > 0 and grid[(y-1)*side + x+ci] != '-') || 
+                    (y < (side-1) and grid[(y+1)*side + x+ci] != '-') ) {
+            puz_count( counters.early_break_cnt++ );
+            return 0;
+        }
+    }
+    return score;
+}
+
+inline uint32_t Grid::score_down( uint32_t x, uint32_t y, const char * word, uint32_t word_len ) const
+{
+    uint32_t     score = (x == 0 || x == (side-1)) ? 5 : 1;
+    const char * col   = &grid_t[x*side];
+    const char * used  = &down_grid[x*side];
+    for( uint32_t ci = 0; ci < word_len; ci++ )
+    {
+        puz_count( counters.cell_cnt++ );
+        if ( used[y+ci] != '-' || 
+             (ci == 0 && y > 0 && col[y-1] != '-') || 
+             (ci == (word_len-1) && (y+ci+1) < side && col[y+ci+1] != '-') ) {
+            puz_count( counters.early_break_cnt++ );
+            return 0;
+        }
+        char c  = word[ci];
+        char gc = col[y+ci];
+        if ( c == gc ) {
+            score++;
+        } else if ( gc != '-' || 
+                    (x > 0 && grid_t[(x-1)*side + y+ci] != '-') || 
+                    (x < (side-1) && grid_t[(x+1)*side + y+ci] != '-') ) {
+            puz_count( counters.early_break_cnt++ );
+            return 0;
+        }
+    }
+    return score;
+}
+
+//-----------------------------------------------------------------------
+// Return the origins in row line (across) or column line (down) where 
+// the word can be placed with a score above 1.  Candidates come from the 
+// legal slot cache and the letter index: on an interior line a letter of 
+// the word must line up with the same letter already in the grid, and no 
+// letter may line up with a different one.  On an edge line uncrossed seed 
+// placements are kept, since they score 5.  The score of a candidate at 
+// origin o is the base score plus the number of used cells in its span.
+//-----------------------------------------------------------------------
+inline uint64_t Grid::candidates( uint32_t line, const char * word, uint32_t word_len, bool is_across ) const
+{
+    uint64_t slots = origins( line, word_len, is_across );
+    if ( slots == 0 ) {
+        puz_count( counters.early_break_cnt++ );
+        return 0;
+    }
+    puz_count( counters.cell_cnt += word_len );
+    const uint64_t * letters  = is_across ? letter_rows.data() : letter_cols.data();
+    uint64_t         occ      = is_across ? row_occ[line] : col_occ[line];
+    uint64_t         anchored = 0;
+    uint64_t         mismatch = 0;
+    for( uint32_t ci = 0; ci < word_len; ci++ )
+    {
+        uint64_t same = letters[WordIndex::letter_code( word[ci] )*side + line];
+        anchored |= same >> ci;
+        mismatch |= (occ & ~same) >> ci;
+    }
+    uint64_t cands = slots & ~mismatch;
+    if ( line != 0 && line != (side-1) ) cands &= anchored;
+    return cands;
+}
+
+//-----------------------------------------------------------------------
+// Recompute the slot origins of row i (across) or column i (down) for 
+// every word length, using whole-line mask operations.  An origin is 
+// dropped when its span overlaps a word in the same direction, when the 
+// cell before or after the span is used, when the span has an empty cell 
+// with a letter on either side, or when the span crosses nothing on an 
+// interior line (its score could not get above 1).  Only letter matching 
+// is left for the scoring functions.
+//-----------------------------------------------------------------------
+void Grid::update_slots( uint32_t i, bool is_across )
+{
+    const std::vector<uint64_t>& occ  = is_across ? row_occ    : col_occ;
+    const std::vector<uint64_t>& used = is_across ? across_occ : down_occ;
+    uint64_t   line     = occ[i];
+    uint64_t   nbrs     = ((i > 0) ? occ[i-1] : 0) | ((i < (side-1)) ? occ[i+1] : 0);
+    uint64_t   bad      = used[i] | (nbrs & ~line);     // cells a span may not include
+    bool       interior = i != 0 && i != (side-1);
+    uint64_t * slots    = &slot_origins[(uint32_t(is_across)*side + i)*(side+1)];
+    uint64_t   any_bad  = 0;
+    uint64_t   any_occ  = 0;
+    slots[0] = 0;
+    for( uint32_t len = 1; len <= side; len++ )
+    {
+        // spans of len cells are the spans of len-1 cells plus one more cell
+        any_bad |= bad  >> (len-1);
+        any_occ |= line >> (len-1);
+        uint64_t after   = (len < 64) ? (line >> len) : 0;      // a span of 64 cells has no cell after it
+        uint64_t origins = bits64_lt( side - len + 1 ) & ~any_bad & ~(line << 1) & ~after;
+        if ( interior ) origins &= any_occ;
+        slots[len] = origins;
+    }
+}
+
+//-----------------------------------------------------------------------
+// Add a word to the grid.
+//-----------------------------------------------------------------------
+void Grid::place( const Clue& clue )
+{
+    uint32_t x         = clue.x;
+    uint32_t y         = clue.y;
+    bool     is_across = clue.is_across;
+    uint32_t word_len  = clue.word.length();
+    for( uint32_t ci = 0; ci < word_len; ci++ ) 
+    {
+        char     ch = clue.word[ci];
+        uint32_t cx = is_across ? (x+ci) : x;
+        uint32_t cy = is_across ? y : (y+ci);
+        if ( grid[cy*side + cx] == '-' ) {
+            filled_cnt++; 
+            if ( use_masks ) {
+                uint32_t code = WordIndex::letter_code( ch );
+                bit64_set( letter_rows[code*side + cy], cx );
+                bit64_set( letter_cols[code*side + cx], cy );
+            }
+        } else {
+            cross_cnt++;
+        }
+        grid[cy*side + cx]   = ch;
+        grid_t[cx*side + cy] = ch;
+        if ( is_across ) {
+            across_grid[cy*side + cx] = ch;
+        } else {
+            down_grid[cx*side + cy] = ch;
+        }
+    }
+    if ( use_masks ) {
+        if ( is_across ) {
+            uint64_t span = bits64_lt( word_len ) << x;
+            row_occ[y]    |= span;
+            across_occ[y] |= span;
+            for( uint32_t ci = 0; ci < word_len; ci++ ) bit64_set( col_occ[x+ci], y );
+        } else {
+            uint64_t span = bits64_lt( word_len ) << y;
+            col_occ[x]    |= span;
+            down_occ[x]   |= span;
+            for( uint32_t ci = 0; ci < word_len; ci++ ) bit64_set( row_occ[y+ci], x );
+        }
+        update_slots_around( x, y, word_len, is_across );
+    }
+    int32_t& at = clue_at[(y*side + x)*2 + is_across];
+    dassert( at < 0, "already have a clue in place" );
+    at = clues.size();
+    clues.push_back( clue );
+    placed_cnt++;
+}
+
+//-----------------------------------------------------------------------
+// Recompute the slot origins of the lines that a word at x,y can affect:
+// in the word's direction, the word's line and its two neighbours;
+// in the other direction, the ones it crosses and the one on each end.
+//-----------------------------------------------------------------------
+void Grid::update_slots_around( uint32_t x, uint32_t y, uint32_t word_len, bool is_across )
+{
+    uint32_t line  = is_across ? y : x;
+    uint32_t first = is_across ? x : y;
+    for( uint32_t i = (line > 0) ? (line-1) : 0; i <= std::min( line+1, side-1 ); i++ ) 
+    {
+        update_slots( i, is_across );
+    }
+    for( uint32_t i = (first > 0) ? (first-1) : 0; i <= std::min( first+word_len, side-1 ); i++ ) 
+    {
+        update_slots( i, !is_across );
+    }
+}
+
+//-----------------------------------------------------------------------
+// Take a word back out of the grid.  Cells it shares with a word in the 
+// other direction keep their letter.
+//-----------------------------------------------------------------------
+void Grid::remove( uint32_t x, uint32_t y, bool is_across )
+{
+    int32_t& at = clue_at[(y*side + x)*2 + is_across];
+    dassert( at >= 0, "no clue to remove" );
+    uint32_t word_len = clues[at].word.length();
+    for( uint32_t ci = 0; ci < word_len; ci++ ) 
+    {
+        uint32_t cx = is_across ? (x+ci) : x;
+        uint32_t cy = is_across ? y : (y+ci);
+        char     other;
+        if ( is_across ) {
+            across_grid[cy*side + cx] = '-';
+            other = down_grid[cx*side + cy];
+        } else {
+            down_grid[cx*side + cy] = '-';
+            other = across_grid[cy*side + cx];
+        }
+        if ( other != '-' ) {
+            cross_cnt--;
+            continue;
+        }
+        if ( use_masks ) {
+            uint32_t code = WordIndex::letter_code( grid[cy*side + cx] );
+            bit64_clear( letter_rows[code*side + cy], cx );
+            bit64_clear( letter_cols[code*side + cx], cy );
+            bit64_clear( row_occ[cy], cx );
+            bit64_clear( col_occ[cx], cy );
+        }
+        grid[cy*side + cx]   = '-';
+        grid_t[cx*side + cy] = '-';
+        filled_cnt--;
+    }
+    if ( use_masks ) {
+        if ( is_across ) {
+            across_occ[y] &= ~(bits64_lt( word_len ) << x);
+        } else {
+            down_occ[x]   &= ~(bits64_lt( word_len ) << y);
+        }
+        update_slots_around( x, y, word_len, is_across );
+    }
+
+    // move the last clue into the hole
+    const Clue& last = clues.back();
+    clue_at[(last.y*side + last.x)*2 + last.is_across] = at;
+    clues[at] = last;
+    clues.pop_back();
+    at = -1;
+    placed_cnt--;
+}
+
+//-----------------------------------------------------------------------
+// A word can be removed only if the letters it leaves behind (the ones 
+// crossed by other words) are not next to each other, since they would 
+// then form a run with no clue.
+//-----------------------------------------------------------------------
+bool Grid::can_remove( uint32_t x, uint32_t y, bool is_across ) const
+{
+    uint32_t word_len = clue( x, y, is_across )->word.length();
+    for( uint32_t ci = 1; ci < word_len; ci++ ) 
+    {
+        bool prev = is_across ? (down_grid[(x+ci-1)*side + y] != '-') : (across_grid[(y+ci-1)*side + x] != '-');
+        bool curr = is_across ? (down_grid[(x+ci)*side + y]   != '-') : (across_grid[(y+ci)*side + x]   != '-');
+        if ( prev && curr ) return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------
+// Find the best location for a word: the highest score, with ties going 
+// to the first location found in x, y, across-before-down order.  Fills 
+// in best.x, best.y and best.is_across and returns the score, or returns 
+// 0 if the word fits nowhere.
+//-----------------------------------------------------------------------
+uint32_t Grid::find_best( const char * word_cs, uint32_t word_len, Clue& best )
+{
+    uint32_t best_score = 0;
+    if ( use_masks && word_len <= side ) {
+        //-----------------------------------------------------------------------
+        // Same search order and scores as below, but only the candidate
+        // origins are visited.
+        //-----------------------------------------------------------------------
+        uint64_t span = bits64_lt( word_len );
+        for( uint32_t j = 0; j < side; j++ ) 
+        {
+            across_origins[j]   = candidates( j, word_cs, word_len, true );
+            down_origins[j]     = candidates( j, word_cs, word_len, false );
+            across_origins_t[j] = 0;
+        }
+        for( uint32_t y = 0; y < side; y++ ) 
+        {
+            for( uint64_t bits = across_origins[y]; bits != 0; bits &= bits-1 )
+            {
+                bit64_set( across_origins_t[bits64_count_trailing_zeroes( bits )], y );
+            }
+        }
+        for( uint32_t x = 0; x < side; x++ ) 
+        {
+            for( uint64_t bits = down_origins[x] | across_origins_t[x]; bits != 0; bits &= bits-1 )
+            {
+                uint32_t y = bits64_count_trailing_zeroes( bits );
+                if ( bit64_is_one( across_origins[y], x ) ) {
+                    uint32_t score = ((y == 0 || y == (side-1)) ? 5 : 1) + bits64_count_ones( row_occ[y] & (span << x) );
+                    if ( score > best_score ) {
+                        best.x         = x;
+                        best.y         = y;
+                        best.is_across = true;
+                        best_score     = score;
+                    }
+                }
+                if ( bit64_is_one( down_origins[x], y ) ) {
+                    uint32_t score = ((x == 0 || x == (side-1)) ? 5 : 1) + bits64_count_ones( col_occ[x] & (span << y) );
+                    if ( score > best_score ) {
+                        best.x         = x;
+                        best.y         = y;
+                        best.is_across = false;
+                        best_score     = score;
+                    }
+                }
+            }
+        }
+    } else {
+        for( uint32_t x = 0; x < side; x++ ) 
+        {
+            for( uint32_t y = 0; y < side; y++ ) 
+            {
+                if ( (x + word_len) <= side ) {
+                    uint32_t score = score_across( x, y, word_cs, word_len );
+                    if ( score > 1 && score > best_score ) {
+                        best.x         = x;
+                        best.y         = y;
+                        best.is_across = true;
+                        best_score     = score;
+                    }
+                }
+
+                if ( (y + word_len) <= side ) {
+                    uint32_t score = score_down( x, y, word_cs, word_len );
+                    if ( score > 1 && score > best_score ) {
+                        best.x         = x;
+                        best.y         = y;
+                        best.is_across = false;
+                        best_score     = score;
+                    }
+                }
+            }
+        }
+    }
+    return best_score;
+}
+
+//-----------------------------------------------------------------------
+// Generate the puzzle from the words using this simple algorithm:
+//
+//     for some number attempts, or until all words have been picked:
+//         pick a random word not picked before (only longer words during the first part)
+//         if the word's entry is already in the grid: continue
+//         for each across/down location of the word:
+//             score the placement of the word in that location
+//         if score > 0:
+//             add the word to one of the locations with the best score found
+//
+// Random numbers come from the calling thread's seed.  If there is a 
+// deadline, the attempts stop there and the grid is left as it is.
+//-----------------------------------------------------------------------
+void Grid::generate( const WordList& words, uint32_t attempts, uint32_t larger_cutoff, uint32_t larger_pct, real64 deadline )
+{
+    std::vector<bool> entries_used( words.table->entries.size(), false );
+    WordSampler sampler( words, side );
+    float large_frac = float(rand_n( larger_pct )) / 100.0;
+    uint32_t attempts_large = float(attempts) * large_frac;
+    for( uint32_t i = 0; i < attempts; i++ ) 
+    {
+        // an attempt with the bitboards is cheap, so they look at the clock every 64; 
+        // a scalar attempt on a big grid can take long enough to blow the deadline
+        if ( deadline != 0.0 && (!use_masks || (i % 64) == 0) && clock_monotonic_time() >= deadline ) {
+            deadline_hit = true;
+            break;
+        }
+
+        // long words first; once they run out, any word
+        uint32_t wi;
+        if ( !(i < attempts_large && sampler.draw( larger_cutoff, wi )) && !sampler.draw( 0, wi ) ) break;
+        puz_count( counters.attempt_cnt++ );
+
+        uint32_t entry = words[wi].entry;
+        if ( entries_used[entry] ) {
+            puz_count( counters.rejected_entry_used_cnt++ );
+            continue;
+        }
+
+        Clue best;
+        uint32_t best_score = find_best( words.letters( wi ), words[wi].len, best );
+        puz_count( counters.scored_cnt++ );
+
+        if ( best_score > 0 ) {
+            puz_count( counters.placed_cnt++ );
+            entries_used[entry] = true;
+            words.clue( wi, best );
+            place( best );
+        }
+    }
+}
+
+//-----------------------------------------------------------------------
+// The value of the grid for the optimizer's objective:
+//
+//     words       words placed
+//     density     cells with a letter
+//     crossings   cells used by both an across and a down word
+//-----------------------------------------------------------------------
+uint32_t Grid::objective_value( std::string objective ) const
+{
+    if ( objective == "density" )   return filled_cnt;
+    if ( objective == "crossings" ) return cross_cnt;
+    return placed_cnt;
+}
+
+//-----------------------------------------------------------------------
+// Improve a filled grid by simulated annealing for optimize_ms milliseconds:
+//
+//     repeat until out of time:
+//         remove a random placed word
+//         try to insert a few random unused words at their best locations
+//         keep the change if the objective went up, or with probability 
+//             exp(delta/T) if it went down, else undo it
+//
+// place() and remove() keep the counters up to date, so the objective
+// delta of a move is just the change in one counter.  The temperature T 
+// falls geometrically from T_START to T_END over the time budget (times 
+// the average word length for density, so it is in cells).  The best 
+// grid seen is restored at the end.  Since the schedule follows the clock, 
+// the result is not repeatable for a given seed.  If the deadline comes 
+// before optimize_ms is up, the schedule is shortened to end there.
+//-----------------------------------------------------------------------
+void Grid::optimize( const WordList& words, uint32_t optimize_ms, std::string objective, real64 deadline )
+{
+    const real64   T_START      = 1.0;
+    const real64   T_END        = 0.02;
+    const uint32_t INSERT_TRIES = 4;
+    dassert( objective == "words" || objective == "density" || objective == "crossings", "unknown objective: " + objective );
+    uint32_t word_cnt = words.size();
+    if ( word_cnt == 0 || placed_cnt == 0 ) return;
+    const uint32_t * counter = (objective == "density")   ? &filled_cnt : 
+                               (objective == "crossings") ? &cross_cnt  : &placed_cnt;
+
+    //-----------------------------------------------------------------------
+    // The used entries are a bit vector over the WordTable entry ids.
+    //-----------------------------------------------------------------------
+    struct Placed
+    {
+        uint32_t    x;
+        uint32_t    y;
+        bool        is_across;
+        uint32_t    entry_id;
+    };
+    const Entry *       entries = words.table->entries.data();
+    std::vector<bool>   entry_used( words.table->entries.size(), false );
+    std::vector<Placed> placed;
+    for( const Clue& clue: clues )
+    {
+        uint32_t eid = clue.entry - entries;
+        placed.push_back( Placed{ clue.x, clue.y, clue.is_across, eid } );
+        entry_used[eid] = true;
+    }
+
+    real64 t_scale = 1.0;
+    if ( objective == "density" ) t_scale = real64(filled_cnt) / real64(placed_cnt);
+    uint32_t value = *counter;
+    uint32_t best_value = value;
+    std::vector<Clue> best_clues = clues;
+
+    real64   start = clock_monotonic_time();
+    real64   secs  = real64(optimize_ms) / 1000.0;
+    if ( deadline != 0.0 && (start + secs) > deadline ) {
+        // squeeze the schedule into the time left
+        secs = deadline - start;
+        deadline_hit = true;
+    }
+    real64   T     = T_START * t_scale;
+    uint64_t move  = 0;
+    std::vector<Placed> inserted;
+    for( ; ; move++ )
+    {
+        if ( (move % 256) == 0 ) {
+            real64 frac = (secs > 0.0) ? ((clock_monotonic_time() - start) / secs) : 1.0;
+            if ( frac >= 1.0 ) break;
+            T = T_START * t_scale * std::pow( T_END / T_START, frac );
+        }
+
+        //-----------------------------------------------------------------------
+        // Remove one word.
+        //-----------------------------------------------------------------------
+        if ( placed.size() == 0 ) break;
+        uint32_t pi = rand_n( placed.size() );
+        Placed   p  = placed[pi];
+        if ( !can_remove( p.x, p.y, p.is_across ) ) continue;
+        Clue removed = *clue( p.x, p.y, p.is_across );
+        remove( p.x, p.y, p.is_across );
+        entry_used[p.entry_id] = false;
+        placed[pi] = placed.back();
+        placed.pop_back();
+
+        //-----------------------------------------------------------------------
+        // Insert some unused words.
+        //-----------------------------------------------------------------------
+        inserted.clear();
+        for( uint32_t k = 0; k < INSERT_TRIES; k++ )
+        {
+            uint32_t wi  = rand_n( word_cnt );
+            uint32_t eid = words[wi].entry;
+            if ( entry_used[eid] ) continue;
+            uint32_t word_len = words[wi].len;
+            if ( word_len > side ) continue;
+            Clue best;
+            if ( find_best( words.letters( wi ), word_len, best ) == 0 ) continue;
+            words.clue( wi, best );
+            place( best );
+            entry_used[eid] = true;
+            inserted.push_back( Placed{ best.x, best.y, best.is_across, eid } );
+        }
+
+        //-----------------------------------------------------------------------
+        // Accept or undo.
+        //-----------------------------------------------------------------------
+        real64 delta = real64(*counter) - real64(value);
+        if ( delta >= 0.0 || real64(rand_n( 1000000 )) < 1000000.0 * std::exp( delta / T ) ) {
+            value = *counter;
+            placed.insert( placed.end(), inserted.begin(), inserted.end() );
+            if ( value > best_value ) {
+                best_value = value;
+                best_clues = clues;
+            }
+        } else {
+            for( size_t k = inserted.size(); k > 0; k-- )
+            {
+                const Placed& q = inserted[k-1];
+                remove( q.x, q.y, q.is_across );
+                entry_used[q.entry_id] = false;
+            }
+            place( removed );
+            entry_used[p.entry_id] = true;
+            placed.push_back( p );
+        }
+    }
+
+    if ( value < best_value ) {
+        for( const Placed& q: placed ) remove( q.x, q.y, q.is_across );
+        for( const Clue& clue: best_clues ) place( clue );
+    }
+    dout << "optimize: " << objective << "=" << best_value << " after " << move << " moves in " << uint64_t(secs * 1000.0) << " ms\n";
+}
+
+//-----------------------------------------------------------------------
+// The best fill has the most words placed, then the most crossings,
+// then the most filled cells.
+//-----------------------------------------------------------------------
+bool Grid::is_better_than( const Grid& other ) const
+{
+    if ( placed_cnt != other.placed_cnt ) return placed_cnt > other.placed_cnt;
+    if ( cross_cnt  != other.cross_cnt )  return cross_cnt  > other.cross_cnt;
+    return filled_cnt > other.filled_cnt;
+}
+
+//-----------------------------------------------------------------------
+// Count words by direction, letters, unchecked cells and entries.
+//-----------------------------------------------------------------------
+GridStats Grid::stats( void ) const
+{
+    GridStats st = { 0, 0, 0, 0, 0 };
+    for( uint32_t y = 0; y < side; y++ )
+    {
+        for( uint32_t x = 0; x < side; x++ )
+        {
+            if ( (across_grid[y*side + x] == '-') != (down_grid[x*side + y] == '-') ) st.unchecked_cnt++;
+        }
+    }
+    std::vector<const Entry *> entries_used;
+    for( const Clue& clue: clues )
+    {
+        if ( clue.is_across ) {
+            st.across_cnt++;
+        } else {
+            st.down_cnt++;
+        }
+        st.letter_cnt += clue.word.length();
+        entries_used.push_back( clue.entry );
+    }
+    std::sort( entries_used.begin(), entries_used.end() );
+    st.entry_cnt = std::unique( entries_used.begin(), entries_used.end() ) - entries_used.begin();
+    return st;
+}
+
+//-----------------------------------------------------------------------
+// Number the clues: each cell where an across or down word starts 
+// gets the next number, in y, x order.  Also leaves the clues in that 
+// order in clue_order.
+//-----------------------------------------------------------------------
+void Grid::number( void )
+{
+    clue_order.resize( clues.size() );
+    for( uint32_t i = 0; i < clues.size(); i++ ) clue_order[i] = i;
+    std::sort( clue_order.begin(), clue_order.end(), [&]( uint32_t a, uint32_t b ) 
+    {
+        const Clue& ca = clues[a];
+        const Clue& cb = clues[b];
+        return (ca.y*side + ca.x)*2 + ca.is_across < (cb.y*side + cb.x)*2 + cb.is_across;
+    } );
+
+    uint32_t clue_num = 0;
+    for( uint32_t i = 0; i < clue_order.size(); i++ )
+    {
+        Clue& clue = clues[clue_order[i]];
+        if ( i == 0 || clue.x != clues[clue_order[i-1]].x || clue.y != clues[clue_order[i-1]].y ) clue_num++;
+        clue.num = clue_num;
+    }
+}
+
+//-----------------------------------------------------------------------
+// Solution cell as written to the ipuz: "#" for a block, else the letter 
+// in uppercase with the special characters converted back.
+//-----------------------------------------------------------------------
+void Grid::write_solution_cell( OutBuf& out, char ch )
+{
+    if ( ch == '-' ) {
+        out << "#";
+    } else if ( ch >= 'a' && ch <= 'z' ) {
+        ch = 'A' + ch - 'a';
+        out << ch;
+    } else {
+        // convert back to special character and make it uppercase
+        dassert( ch >= '0' && ch <= '9', "unexpected special char in grid" );
+        switch( ch )
+        {
+            case '0': out << "À"; break;
+            case '1': out << "Á"; break;
+            case '2': out << "È"; break;
+            case '3': out << "É"; break;
+            case '4': out << "Ì"; break;
+            case '5': out << "Í"; break;
+            case '6': out << "Ò"; break;
+            case '7': out << "Ó"; break;
+            case '8': out << "Ù"; break;
+            case '9': out << "U'"; break;
+            default:  die( "something is wrong" ); break;
+        }            
+    }
+}
+
+//-----------------------------------------------------------------------
+// Clue text: the question, then the answer with the placed word blanked out.
+//-----------------------------------------------------------------------
+std::string Grid::clue_text( const Clue& clue )
+{
+    std::string_view word = clue.word;
+    uint32_t     first  = clue.pos;
+    uint32_t     last   = clue.pos_last;
+    std::string_view a  = clue.a;
+    std::string  s      = std::string( clue.entry->q ) + " ==> ";
+    for( uint32_t j = 0; j < a.length(); j++ ) 
+    {
+        if ( j >= first && j <= last ) {
+            if ( (j-first) < word.length() ) s += "_";
+        } else {
+            s += a[j];
+        }
+    }
+    return s;
+}
+
+//-----------------------------------------------------------------------
+// Generate .html file, or with html=false the ipuz object from it.
+//-----------------------------------------------------------------------
+void Grid::write( OutBuf& out, std::string title, bool html )
+{
+    puz_count( real64 start = clock_monotonic_time() );
+    number();
+    puz_count( real64 numbered = clock_monotonic_time() );
+    puz_count( puz_counters.numbering_ms += (numbered - start) * 1000.0 );
+
+    if ( html ) {
+        out << "<!DOCTYPE html>\n";
+        out << "<html lang=\"en\">\n";
+        out << "<head>\n";
+        out << "<meta charset=\"utf-8\"/>\n";
+        out << "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\"/>\n";
+        out << "<link rel=\"stylesheet\" type=\"text/css\" href=\"exolve-m.css?v1.35\"/>\n";
+        out << "<script src=\"exolve-m.js?v1.35\"></script>\n";
+        out << "<script src=\"exolve-from-ipuz.js?v1.35\"></script>\n";
+        out << "\n";
+        out << "<title>Test-Ipuz-Solved</title>\n";
+        out << "\n";
+        out << "</head>\n";
+        out << "<body>\n";
+        out << "<script>\n";
+        out << "let ipuz =\n";
+    }
+
+    // header
+    out << "{\n";
+    out << "\"origin\": \"Bob Alfieri\",\n";
+    out << "\"version\": \"http://ipuz.org/v1\",\n";
+    out << "\"kind\": [\"http://ipuz.org/crossword#1\"],\n";
+    //out << "\"copyright\": \"2022 Robert A. Alfieri (this puzzle), Viresh Ratnakar (crossword program)\",\n";
+    //out << "\"author\": \"Bob Alfieri\",\n";
+    out << "\"publisher\": \"Robert A. Alfieri\",\n";
+    out << "\"title\": \"" << title << "\",\n";
+    out << "\"intro\": \"\",\n";
+    out << "\"difficulty\": \"Moderate\",\n";
+    out << "\"empty\": \"0\",\n";
+    out << "\"dimensions\": { \"width\": " << side << ", \"height\": " << side << " },\n";
+    out << "\n";
+
+    // solution
+    out << "\"solution\": [\n";
+    for( uint32_t y = 0; y < side; y++ )
+    {
+        for( uint32_t x = 0; x < side; x++ )
+        {
+            if ( x == 0 ) {
+                out << "    [";
+            } else {
+                out << ",";
+            }
+            out << "\"";
+            write_solution_cell( out, grid[y*side + x] );
+            out << "\"";
+        }
+        out << "]";
+        if ( y != (side-1) ) out << ",";
+        out << "\n";
+    }
+    out << "],\n";
+
+    // labels, walking the clues in the same order as the cells
+    out << "\"puzzle\": [\n";
+    uint32_t k = 0;
+    for( uint32_t y = 0; y < side; y++ )
+    {
+        for( uint32_t x = 0; x < side; x++ )
+        {
+            if ( x == 0 ) {
+                out << "    [";
+            } else {
+                out << ", ";
+            }
+            if ( k < clue_order.size() && clues[clue_order[k]].x == x && clues[clue_order[k]].y == y ) {
+                out << clues[clue_order[k]].num;
+                while( k < clue_order.size() && clues[clue_order[k]].x == x && clues[clue_order[k]].y == y ) k++;
+            } else if ( grid[y*side + x] != '-' ) {
+                out << " 0";
+            } else {
+                out << "\"#\"";
+            }
+        }
+        out << "]";
+        if ( y != (side-1) ) out << ",";
+        out << "\n";
+    }
+    out << "]," << "\n";
+
+    // clues
+    out << "\"clues\": {\n";
+    for( uint32_t i = 0; i < 2; i++ )
+    {
+        bool        is_across = i == 0;
+        std::string which_mc = is_across ? "Across" : "Down";
+        out << "    \"" << which_mc << "\": [";
+        bool have_one = false;
+        for( uint32_t ci: clue_order )
+        {
+            const Clue& cinfo = clues[ci];
+            if ( cinfo.is_across != is_across ) continue;
+            if ( have_one ) out << ", "; 
+            have_one = true;
+            out << "\n";
+            out << "        [" << cinfo.num << ", \"" << clue_text( cinfo ) << "\"]";
+        }
+        out << "\n    ]";
+        if ( is_across ) out << ",";
+        out << "\n";
+    }
+    out << "},\n";
+    out << "}\n";
+
+    if ( html ) {
+        out << "text = exolveFromIpuz(ipuz)\n";
+        //out << "text += '\\n    exolve-option: allow-chars:ÀÁÈÉÌÍÒÓÙÚ\\n'\n";
+        out << "text += '\\n    exolve-language: it Latin\\n'\n";
+        out << "text += '\\n    exolve-end\\n'\n";
+        out << "createExolve(text)\n";
+        out << "</script>\n";
+        out << "</body>\n";
+        out << "</html>\n";
+    }
+    puz_count( puz_counters.output_ms += (clock_monotonic_time() - numbered) * 1000.0 );
+}
+
+//-----------------------------------------------------------------------
+// Generate a data-only .ipuz file: strict JSON with no whitespace and only 
+// the fields needed to play it.  www/player.html supplies the rest.
+//-----------------------------------------------------------------------
+void Grid::write_ipuz( OutBuf& out, std::string title )
+{
+    puz_count( real64 start = clock_monotonic_time() );
+    number();
+    puz_count( real64 numbered = clock_monotonic_time() );
+    puz_count( puz_counters.numbering_ms += (numbered - start) * 1000.0 );
+
+    out << "{\"version\":\"http://ipuz.org/v1\",\"kind\":[\"http://ipuz.org/crossword#1\"]";
+    out << ",\"title\":" << json_str( title ) << ",\"empty\":\"0\"";
+    out << ",\"dimensions\":{\"width\":" << side << ",\"height\":" << side << "}";
+
+    out << ",\"solution\":[";
+    for( uint32_t y = 0; y < side; y++ )
+    {
+        out << ((y == 0) ? "[" : ",[");
+        for( uint32_t x = 0; x < side; x++ )
+        {
+            out << ((x == 0) ? "\"" : ",\"");
+            write_solution_cell( out, grid[y*side + x] );
+            out << "\"";
+        }
+        out << "]";
+    }
+    out << "]";
+
+    out << ",\"puzzle\":[";
+    uint32_t k = 0;
+    for( uint32_t y = 0; y < side; y++ )
+    {
+        out << ((y == 0) ? "[" : ",[");
+        for( uint32_t x = 0; x < side; x++ )
+        {
+            if ( x != 0 ) out << ",";
+            if ( k < clue_order.size() && clues[clue_order[k]].x == x && clues[clue_order[k]].y == y ) {
+                out << clues[clue_order[k]].num;
+                while( k < clue_order.size() && clues[clue_order[k]].x == x && clues[clue_order[k]].y == y ) k++;
+            } else if ( grid[y*side + x] != '-' ) {
+                out << "0";
+            } else {
+                out << "\"#\"";
+            }
+        }
+        out << "]";
+    }
+    out << "]";
+
+    out << ",\"clues\":{";
+    for( uint32_t i = 0; i < 2; i++ )
+    {
+        bool is_across = i == 0;
+        out << (is_across ? "\"Across\":[" : ",\"Down\":[");
+        bool have_one = false;
+        for( uint32_t ci: clue_order )
+        {
+            const Clue& cinfo = clues[ci];
+            if ( cinfo.is_across != is_across ) continue;
+            if ( have_one ) out << ",";
+            have_one = true;
+            out << "[" << cinfo.num << "," << json_str( clue_text( cinfo ) ) << "]";
+        }
+        out << "]";
+    }
+    out << "}}\n";
+    puz_count( puz_counters.output_ms += (clock_monotonic_time() - numbered) * 1000.0 );
+}
+
+//-----------------------------------------------------------------------
+// Generate an Across Lite .puz file (version 1.3, not scrambled).
+//
+// Layout: a 0x34-byte header, the solution and fill grids (row-major, 
+// '.' for blocks, '-' for empty fill), then NUL-terminated Latin-1 strings: 
+// title, author, copyright, one clue per word in numbering order 
+// (across before down at the same number), and notes.
+//-----------------------------------------------------------------------
+uint16_t Grid::puz_cksum( const char * data, size_t len, uint16_t cksum )
+{
+    for( size_t i = 0; i < len; i++ )
+    {
+        cksum = (cksum >> 1) | ((cksum & 1) << 15);     // rotate right
+        cksum += uint8_t(data[i]);
+    }
+    return cksum;
+}
+
+void Grid::write_puz( OutBuf& out, std::string title )
+{
+    puz_count( real64 start = clock_monotonic_time() );
+    number();
+    puz_count( real64 numbered = clock_monotonic_time() );
+    puz_count( puz_counters.numbering_ms += (numbered - start) * 1000.0 );
+    dassert( side <= 255, "side must be at most 255 for .puz format" );
+    dassert( clues.size() <= 0xffff, "too many clues for .puz format" );
+
+    const size_t HDR_LEN = 0x34;
+    size_t base = out.s.length();
+    out.s.append( HDR_LEN, '\0' );
+    char * hdr = &out.s[base];
+    memcpy( hdr + 0x02, "ACROSS&DOWN", 12 );    // includes the NUL
+    memcpy( hdr + 0x18, "1.3", 4 );
+    hdr[0x2c] = side;
+    hdr[0x2d] = side;
+    hdr[0x2e] = clues.size() & 0xff;
+    hdr[0x2f] = clues.size() >> 8;
+    hdr[0x30] = 1;
+
+    // grids, with the special characters mapped back to Latin-1 uppercase
+    size_t sol_off = out.s.length();
+    for( uint32_t i = 0; i < side*side; i++ )
+    {
+        char ch = grid[i];
+        if ( ch == '-' ) {
+            ch = '.';
+        } else if ( ch >= 'a' && ch <= 'z' ) {
+            ch = 'A' + ch - 'a';
+        } else {
+            dassert( ch >= '0' && ch <= '9', "unexpected special char in grid" );
+            static const char latin1[] = "\xc0\xc1\xc8\xc9\xcc\xcd\xd2\xd3\xd9\xda";   // ÀÁÈÉÌÍÒÓÙÚ
+            ch = latin1[ch - '0'];
+        }
+        out << ch;
+    }
+    size_t fill_off = out.s.length();
+    for( uint32_t i = 0; i < side*side; i++ )
+    {
+        out << ((grid[i] == '-') ? '.' : '-');
+    }
+
+    // strings; clue_order has down before across at the same cell, .puz wants across first
+    size_t strs_off = out.s.length();
+    std::string title_l = latin1_str( title );
+    out << std::string_view( title_l.c_str(), title_l.length()+1 );
+    out << std::string_view( "Bob Alfieri", 12 );
+    out << '\0';                                // copyright
+    std::vector<std::pair<size_t, size_t>> clue_strs;   // offset and length of each clue text
+    for( size_t k = 0; k < clue_order.size(); )
+    {
+        size_t k_last = k;
+        while( (k_last+1) < clue_order.size() && clues[clue_order[k_last+1]].x == clues[clue_order[k]].x && 
+                                                 clues[clue_order[k_last+1]].y == clues[clue_order[k]].y ) k_last++;
+        for( size_t kk = k_last+1; kk-- > k; )
+        {
+            std::string text = latin1_str( clue_text( clues[clue_order[kk]] ) );
+            clue_strs.push_back( std::make_pair( out.s.length() - base, text.length() ) );
+            out << text << '\0';
+        }
+        k = k_last+1;
+    }
+    out << '\0';                                // notes
+
+    // checksums
+    const char * d = out.s.data() + base;
+    size_t sol_len = side*side;
+    uint16_t c_cib  = puz_cksum( d + 0x2c, 8, 0 );
+    uint16_t c_sol  = puz_cksum( d + sol_off - base, sol_len, 0 );
+    uint16_t c_fill = puz_cksum( d + fill_off - base, sol_len, 0 );
+    uint16_t c_text = 0;
+    const char * strs = d + strs_off - base;
+    size_t title_len = title_l.length();
+    if ( title_len != 0 ) c_text = puz_cksum( strs, title_len+1, c_text );
+    c_text = puz_cksum( strs + title_len+1, 12, c_text );                  // author
+    for( const auto& cs: clue_strs ) c_text = puz_cksum( d + cs.first, cs.second, c_text );
+
+    uint16_t c_all = c_cib;
+    c_all = puz_cksum( d + sol_off - base, sol_len, c_all );
+    c_all = puz_cksum( d + fill_off - base, sol_len, c_all );
+    if ( title_len != 0 ) c_all = puz_cksum( strs, title_len+1, c_all );
+    c_all = puz_cksum( strs + title_len+1, 12, c_all );
+    for( const auto& cs: clue_strs ) c_all = puz_cksum( d + cs.first, cs.second, c_all );
+
+    hdr = &out.s[base];
+    hdr[0x00] = c_all & 0xff;
+    hdr[0x01] = c_all >> 8;
+    hdr[0x0e] = c_cib & 0xff;
+    hdr[0x0f] = c_cib >> 8;
+    const char * mask = "ICHEATED";
+    uint16_t     c[4] = { c_cib, c_sol, c_fill, c_text };
+    for( uint32_t i = 0; i < 4; i++ )
+    {
+        hdr[0x10+i] = mask[i]   ^ (c[i] & 0xff);
+        hdr[0x14+i] = mask[4+i] ^ (c[i] >> 8);
+    }
+    puz_count( puz_counters.output_ms += (clock_monotonic_time() - numbered) * 1000.0 );
+}
+
+//-----------------------------------------------------------------------
+// Block patterns for the csp engine.  A pattern is side*side characters, 
+// indexed by y*side + x, with '#' for a block and '-' for a white cell.
+//
+// A pattern file has one line per row.  '#' is a block and any other 
+// character is a white cell.
+//-----------------------------------------------------------------------
+std::string pattern_read( std::string path, uint32_t side )
+{
+    std::string text;
+    file_read( path, text );
+    std::string pattern = "";
+    uint32_t y = 0;
+    size_t pos = 0;
+    while( pos < text.length() )
+    {
+        size_t nl = text.find( '\n', pos );
+        std::string_view line = trim( std::string_view( text ).substr( pos, (nl == std::string::npos) ? std::string::npos : (nl - pos) ) );
+        pos = (nl == std::string::npos) ? text.length() : (nl + 1);
+        if ( line.length() == 0 ) continue;
+        dassert( line.length() == side, "pattern " + path + " row " + std::to_string(y) + " does not have " + std::to_string(side) + " cells" );
+        for( char ch: line ) pattern += (ch == '#') ? '#' : '-';
+        y++;
+    }
+    dassert( y == side, "pattern " + path + " does not have " + std::to_string(side) + " rows" );
+    return pattern;
+}
+
+//-----------------------------------------------------------------------
+// Generate a random block pattern with about block_pct% blocks, optionally 
+// with 180-degree rotational symmetry.  In the result, every run of white
+// cells has 1 letter or a length that has words in the index (picked words 
+// have more than 3 letters), and every white cell is in some longer run.
+//
+// A pattern starts as a lattice: blocks on every other cell of every other
+// row, so across words go in the rows in between, down words in the columns
+// in between, and every other letter of a word is checked.  Fully checked 
+// open patterns are rarely fillable once words have 4+ letters.  The lattice 
+// has about 25% blocks; more are added at random to cut the long runs.
+//
+// Blocks are only ever added one at a time (with their mirror), and only 
+// where every run they cut is left usable, so a repair never cascades into 
+// solid regions of blocks.  A pattern that cannot be repaired this way, or 
+// that ends up with too many blocks or too few slots, is thrown away and 
+// another one is tried.
+//
+// Big grids can take a while, so if the deadline (a clock_monotonic_time(), 
+// 0 means none) passes first, "" is returned.
+//-----------------------------------------------------------------------
+const uint32_t PATTERN_TRIES    = 50;
+const uint32_t PATTERN_WORD_MIN = 200;          // fewer words of a length than this and its runs are cut
+
+std::string pattern_generate( uint32_t side, bool symmetry, uint32_t block_pct, const WordIndex& index, real64 deadline=0.0 )
+{
+    std::string pattern;
+    uint32_t    block_cnt = 0;                  // kept up to date by try_block()
+    auto run_len = [&]( uint32_t x, uint32_t y, bool is_across ) -> uint32_t
+    {
+        uint32_t len = 1;
+        for( int32_t i = int32_t(is_across ? x : y) - 1; i >= 0 && pattern[is_across ? (y*side + i) : (i*side + x)] != '#'; i-- ) len++;
+        for( uint32_t i = (is_across ? x : y) + 1; i < side && pattern[is_across ? (y*side + i) : (i*side + x)] != '#'; i++ ) len++;
+        return len;
+    };
+    auto usable = [&]( uint32_t len ) -> bool
+    {
+        return len == 1 || index.word_cnt( len ) >= PATTERN_WORD_MIN;
+    };
+
+    //-----------------------------------------------------------------------
+    // Block x,y and its mirror if the runs they cut are all left usable 
+    // and no white cell next to them is left out of every slot.
+    // Returns false, with the pattern unchanged, if not.  Only unchecked 
+    // lattice cells (x and y both even or both odd) are blocked, so each 
+    // block cuts a single word and the lattice is kept.
+    //-----------------------------------------------------------------------
+    auto neighbor_ok = [&]( int32_t x, int32_t y, bool is_across ) -> bool
+    {
+        if ( x < 0 || y < 0 || x >= int32_t(side) || y >= int32_t(side) || pattern[y*side + x] == '#' ) return true;
+        uint32_t len   = run_len( x, y, is_across );        // the run that was cut
+        uint32_t other = run_len( x, y, !is_across );
+        return usable( len ) && (len > 1 || other > 1);
+    };
+    auto cuts_ok = [&]( int32_t x, int32_t y ) -> bool
+    {
+        return neighbor_ok( x-1, y, true ) && neighbor_ok( x+1, y, true ) && neighbor_ok( x, y-1, false ) && neighbor_ok( x, y+1, false );
+    };
+    auto try_block = [&]( uint32_t x, uint32_t y ) -> bool
+    {
+        uint32_t mx = side-1-x;
+        uint32_t my = side-1-y;
+        if ( pattern[y*side + x] == '#' || (x % 2) != (y % 2) ) return false;
+        pattern[y*side + x] = '#';
+        if ( symmetry ) pattern[my*side + mx] = '#';
+        if ( cuts_ok( x, y ) && (!symmetry || cuts_ok( mx, my )) ) {
+            block_cnt += (symmetry && (mx != x || my != y)) ? 2 : 1;
+            return true;
+        }
+        pattern[y*side + x] = '-';
+        if ( symmetry ) pattern[my*side + mx] = '-';
+        return false;
+    };
+
+    uint32_t    block_target = side*side*block_pct/100;
+    uint32_t    block_max    = block_target + block_target/4 + 2;
+    uint32_t    slot_min     = side;
+    std::string best         = "";
+    uint32_t    best_blocks  = 0;
+    for( uint32_t t = 0; t < PATTERN_TRIES; t++ )
+    {
+        if ( deadline != 0.0 && clock_monotonic_time() >= deadline ) return "";
+
+        //-----------------------------------------------------------------------
+        // Lattice.  With symmetry, the bottom half is the mirror of the top,
+        // which for an even side shifts its blocks over by one.
+        //-----------------------------------------------------------------------
+        pattern = std::string( side*side, '-' );
+        for( uint32_t y = 1; y < (symmetry ? (side+1)/2 : side); y += 2 )
+        {
+            for( uint32_t x = 0; x < side; x += 2 )
+            {
+                pattern[y*side + x] = '#';
+                if ( symmetry ) pattern[(side-1-y)*side + (side-1-x)] = '#';
+            }
+        }
+
+        //-----------------------------------------------------------------------
+        // Add random blocks.
+        //-----------------------------------------------------------------------
+        block_cnt = std::count( pattern.begin(), pattern.end(), '#' );
+        for( uint32_t tries = 20*side*side; tries > 0 && block_cnt < block_target; tries-- )
+        {
+            if ( deadline != 0.0 && (tries % 1024) == 0 && clock_monotonic_time() >= deadline ) return "";
+            try_block( rand_n( side ), rand_n( side ) );
+        }
+
+        //-----------------------------------------------------------------------
+        // What is left are runs not cut yet that have no words of their 
+        // length, e.g., a whole row.  Cut each at a random cell that works.
+        //-----------------------------------------------------------------------
+        bool ok = true;
+        for( uint32_t d = 0; ok && d < 2; d++ )
+        {
+            bool is_across = d == 0;
+            for( uint32_t line = 0; ok && line < side; line++ )
+            {
+                for( uint32_t i = 0; ok && i < side; )
+                {
+                    uint32_t x = is_across ? i : line;
+                    uint32_t y = is_across ? line : i;
+                    if ( pattern[y*side + x] == '#' ) {
+                        i++;
+                        continue;
+                    }
+                    uint32_t len = run_len( x, y, is_across );
+                    if ( usable( len ) ) {
+                        i += len;
+                        continue;
+                    }
+                    uint32_t start = rand_n( len );
+                    ok = false;
+                    for( uint32_t k = 0; !ok && k < len; k++ )
+                    {
+                        uint32_t c = (start + k) % len;
+                        ok = try_block( is_across ? (x+c) : x, is_across ? y : (y+c) );
+                    }
+                    // look at this line again from the start of the run
+                }
+            }
+        }
+        if ( !ok ) continue;
+
+        uint32_t slot_cnt = 0;
+        for( uint32_t d = 0; d < 2; d++ )
+        {
+            bool is_across = d == 0;
+            for( uint32_t line = 0; line < side; line++ )
+            {
+                for( uint32_t i = 0; i < side; )
+                {
+                    uint32_t x = is_across ? i : line;
+                    uint32_t y = is_across ? line : i;
+                    uint32_t len = (pattern[y*side + x] == '#') ? 1 : run_len( x, y, is_across );
+                    slot_cnt += pattern[y*side + x] != '#' && len > 1;
+                    i += len;
+                }
+            }
+        }
+        if ( best == "" || block_cnt < best_blocks ) {
+            best        = pattern;
+            best_blocks = block_cnt;
+        }
+        if ( block_cnt <= block_max && slot_cnt >= slot_min ) return pattern;
+    }
+
+    // no pattern met the targets; the densest valid one (if any) is used and a failed fill falls back to greedy
+    return (best != "") ? best : pattern;
+}
+
+//-----------------------------------------------------------------------
+// Constraint-satisfaction fill of a block pattern.
+//
+// Every run of 2 or more white cells is a slot that must get a word.
+// The search is depth-first backtracking:
+//
+//     pick the unfilled slot with the fewest candidate words (most constrained)
+//     for each candidate word, starting at a random one:
+//         skip it if its entry or its text is already used
+//         place it and narrow the candidates of each crossing slot to the
+//             ones with the new letter (forward checking, starting from the 
+//             WordIndex); undo if any becomes empty
+//         recurse
+//
+// An early bad choice can leave the search stuck deep in the tree, so it
+// restarts from scratch (with other random starting words) after 
+// CSP_RESTART_NODES nodes, then twice that, and so on.
+//
+// The search stops at node_max nodes or at time_end.  Only a complete 
+// fill is placed in the grid: in a partial one, the unfilled slots would 
+// be runs of letters with no clue.  The caller falls back to the greedy 
+// engine when there is no complete fill.
+//
+// A restart that ends before its node limit has tried every word in the 
+// first slot (nothing is used yet) and everything under each, so the 
+// pattern has no fill at all and exhausted is set.  This happens when 
+// the corpus cannot fill some crossing, e.g., one where every candidate 
+// word of a slot would need a letter no crossing word has in that place.
+//-----------------------------------------------------------------------
+const uint64_t CSP_RESTART_NODES = 1000;
+
+class CspFill
+{
+public:
+    uint64_t    node_cnt;                       // nodes expanded (words tried in a slot)
+    uint64_t    backtrack_cnt;                  // words tried and then taken back
+    uint32_t    slot_cnt;
+    uint32_t    filled_slot_cnt;                // in the best fill found, placed only if complete
+    bool        out_of_budget;
+    bool        exhausted;                      // the pattern has no fill
+
+    // time_end is a clock_monotonic_time(), 0 means none
+    CspFill( uint32_t side, const std::string& pattern, const WordList& words, const WordIndex& index, 
+             uint64_t node_max, real64 time_end );
+
+    bool fill( Grid& grid );                    // returns true if every slot got a word
+
+private:
+    struct Slot
+    {
+        uint32_t                x;
+        uint32_t                y;
+        bool                    is_across;
+        std::vector<uint32_t>   cells;          // y*side + x
+        std::vector<uint32_t>   crossings;      // other slots that share a cell
+        std::vector<uint32_t>   crossing_pos;   // index of that cell in the other slot
+        std::vector<uint32_t>   crossing_ci;    // index of that cell in this slot
+    };
+
+    struct Trail
+    {
+        uint32_t                slot;
+        bool                    constrained;
+        std::vector<uint32_t>   domain;
+    };
+
+    uint32_t                            side;
+    const WordList&                     words;
+    const WordIndex&                    index;
+    uint64_t                            node_max;
+    uint64_t                            restart_node_max;       // node_cnt at which this restart gives up
+    real64                              time_end;
+    std::vector<Slot>                   slots;
+    std::vector<std::vector<uint32_t>>  domains;        // candidate word ids of constrained slots
+    std::vector<bool>                   constrained;    // false means every word of that length
+    std::vector<int32_t>                assigned;       // word id or -1
+    std::vector<int32_t>                best_assigned;
+    uint32_t                            best_cnt;
+    std::string                         letters;        // '-' is empty
+    std::vector<uint8_t>                cover;          // filled slots through each cell
+    std::vector<bool>                   entries_used;       // by WordTable entry id
+    std::map<std::string_view, bool>    words_used;
+    std::vector<Trail>                  trail;
+
+    inline uint32_t domain_size( uint32_t s ) const 
+    { 
+        return constrained[s] ? domains[s].size() : index.word_cnt( slots[s].cells.size() ); 
+    }
+    std::string slot_pattern( uint32_t s ) const;
+    void assign( uint32_t s, uint32_t wi );
+    void unassign( uint32_t s );
+    bool search( uint32_t assigned_cnt );
+};
+
+CspFill::CspFill( uint32_t side, const std::string& pattern, const WordList& words, const WordIndex& index, 
+                  uint64_t node_max, real64 time_end )
+    : node_cnt(0), backtrack_cnt(0), slot_cnt(0), filled_slot_cnt(0), out_of_budget(false), exhausted(false),
+      side(side), words(words), index(index), node_max(node_max), restart_node_max(node_max), time_end(time_end), best_cnt(0)
+{
+    letters  = std::string( side*side, '-' );
+    cover.resize( side*side, 0 );
+    entries_used.resize( words.table->entries.size(), false );
+
+    //-----------------------------------------------------------------------
+    // Find the slots and which slots cross.
+    //-----------------------------------------------------------------------
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> cell_slots( side*side );   // (slot, index of cell in slot)
+    for( uint32_t d = 0; d < 2; d++ )
+    {
+        bool is_across = d == 0;
+        for( uint32_t line = 0; line < side; line++ )
+        {
+            for( uint32_t i = 0; i < side; )
+            {
+                uint32_t x = is_across ? i : line;
+                uint32_t y = is_across ? line : i;
+                if ( pattern[y*side + x] == '#' ) {
+                    i++;
+                    continue;
+                }
+                Slot slot;
+                slot.x         = x;
+                slot.y         = y;
+                slot.is_across = is_across;
+                for( ; i < side && pattern[is_across ? (line*side + i) : (i*side + line)] != '#'; i++ )
+                {
+                    slot.cells.push_back( is_across ? (line*side + i) : (i*side + line) );
+                }
+                if ( slot.cells.size() >= 2 ) {
+                    for( uint32_t ci = 0; ci < slot.cells.size(); ci++ ) cell_slots[slot.cells[ci]].push_back( std::make_pair( slots.size(), ci ) );
+                    slots.push_back( slot );
+                }
+            }
+        }
+    }
+    for( uint32_t c = 0; c < side*side; c++ )
+    {
+        if ( cell_slots[c].size() == 2 ) {
+            for( uint32_t k = 0; k < 2; k++ )
+            {
+                Slot& slot = slots[cell_slots[c][k].first];
+                slot.crossings.push_back( cell_slots[c][k^1].first );
+                slot.crossing_pos.push_back( cell_slots[c][k^1].second );
+                slot.crossing_ci.push_back( cell_slots[c][k].second );
+            }
+        }
+    }
+    slot_cnt = slots.size();
+    domains.resize( slot_cnt );
+    constrained.resize( slot_cnt, false );
+    assigned.resize( slot_cnt, -1 );
+    best_assigned = assigned;
+}
+
+std::string CspFill::slot_pattern( uint32_t s ) const
+{
+    std::string p;
+    for( uint32_t c: slots[s].cells ) p += letters[c];
+    return p;
+}
+
+void CspFill::assign( uint32_t s, uint32_t wi )
+{
+    const char * word = words.letters( wi );
+    const Slot& slot = slots[s];
+    for( uint32_t ci = 0; ci < slot.cells.size(); ci++ )
+    {
+        letters[slot.cells[ci]] = word[ci];
+        cover[slot.cells[ci]]++;
+    }
+    assigned[s] = wi;
+    entries_used[words[wi].entry] = true;
+    words_used[words.word( wi )] = true;
+}
+
+void CspFill::unassign( uint32_t s )
+{
+    uint32_t wi = assigned[s];
+    for( uint32_t c: slots[s].cells )
+    {
+        if ( --cover[c] == 0 ) letters[c] = '-';
+    }
+    assigned[s] = -1;
+    entries_used[words[wi].entry] = false;
+    words_used.erase( words.word( wi ) );
+}
+
+bool CspFill::search( uint32_t assigned_cnt )
+{
+    if ( assigned_cnt > best_cnt ) {
+        best_cnt      = assigned_cnt;
+        best_assigned = assigned;
+    }
+    if ( assigned_cnt == slot_cnt ) return true;
+
+    //-----------------------------------------------------------------------
+    // Most constrained slot first.
+    //-----------------------------------------------------------------------
+    uint32_t s = slot_cnt;
+    uint32_t s_size = 0;
+    for( uint32_t i = 0; i < slot_cnt; i++ )
+    {
+        if ( assigned[i] >= 0 ) continue;
+        uint32_t size = domain_size( i );
+        if ( s == slot_cnt || size < s_size ) {
+            s      = i;
+            s_size = size;
+        }
+    }
+    if ( s_size == 0 ) return false;
+    if ( !constrained[s] ) {
+        index.candidates( slot_pattern( s ), domains[s] );
+        constrained[s] = true;
+    }
+
+    const std::vector<uint32_t>& domain = domains[s];   // not changed below while s is assigned
+    uint32_t start = rand_n( s_size );
+    for( uint32_t k = 0; k < s_size; k++ )
+    {
+        uint32_t wi = domain[(start + k) % s_size];
+        if ( entries_used[words[wi].entry] || words_used.find( words.word( wi ) ) != words_used.end() ) continue;
+
+        if ( node_cnt >= node_max || (time_end != 0.0 && (node_cnt % 1024) == 0 && clock_monotonic_time() >= time_end) ) {
+            out_of_budget = true;
+            return false;
+        }
+        if ( node_cnt >= restart_node_max ) return false;
+        node_cnt++;
+        assign( s, wi );
+
+        // forward checking
+        size_t trail_size = trail.size();
+        bool ok = true;
+        const Slot& slot = slots[s];
+        for( uint32_t c = 0; c < slot.crossings.size(); c++ )
+        {
+            uint32_t t = slot.crossings[c];
+            if ( assigned[t] >= 0 ) continue;
+            Trail tr;
+            tr.slot        = t;
+            tr.constrained = constrained[t];
+            trail.push_back( tr );
+            std::swap( trail.back().domain, domains[t] );
+            if ( tr.constrained ) {
+                // keep the old candidates that have the new letter
+                uint32_t pos = slot.crossing_pos[c];
+                char     ch  = words.letters( wi )[slot.crossing_ci[c]];
+                for( uint32_t ti: trail.back().domain ) 
+                {
+                    if ( words.letters( ti )[pos] == ch ) domains[t].push_back( ti );
+                }
+            } else {
+                index.candidates( slot_pattern( t ), domains[t] );
+                constrained[t] = true;
+            }
+            if ( domains[t].size() == 0 ) {
+                ok = false;
+                break;
+            }
+        }
+
+        if ( ok && search( assigned_cnt+1 ) ) return true;
+
+        while( trail.size() > trail_size )
+        {
+            Trail& tr = trail.back();
+            std::swap( domains[tr.slot], tr.domain );
+            constrained[tr.slot] = tr.constrained;
+            trail.pop_back();
+        }
+        unassign( s );
+        backtrack_cnt++;
+        if ( out_of_budget || node_cnt >= restart_node_max ) return false;
+    }
+    return false;
+}
+
+bool CspFill::fill( Grid& grid )
+{
+    bool complete = false;
+    for( uint64_t restart_nodes = CSP_RESTART_NODES; !complete && !out_of_budget && node_cnt < node_max; restart_nodes *= 2 )
+    {
+        restart_node_max = std::min( node_cnt + restart_nodes, node_max );
+        complete  = search( 0 );
+        exhausted = !complete && !out_of_budget && node_cnt < restart_node_max;
+        if ( exhausted ) break;                 // searched the whole tree
+    }
+    filled_slot_cnt = complete ? slot_cnt : best_cnt;
+    if ( !complete ) return false;
+    for( uint32_t s = 0; s < slot_cnt; s++ )
+    {
+        Clue clue;
+        words.clue( assigned[s], clue );
+        clue.x         = slots[s].x;
+        clue.y         = slots[s].y;
+        clue.is_across = slots[s].is_across;
+        grid.place( clue );
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------
+// Options for one puzzle.  These come from the command line or from
+// one line of a -batch manifest.
+//-----------------------------------------------------------------------
+struct Options
+{
+    std::string subjects_s          = "";
+    uint64_t    seed                = uint64_t( clock_time() );
+    uint32_t    thread_cnt          = thread_hardware_thread_cnt();   // actual number of CPU HW threads
+    uint32_t    side                = 17;
+    bool        reverse             = false;
+    uint32_t    attempts            = 10000;
+    uint32_t    larger_cutoff       = 7;
+    uint32_t    larger_pct          = 50;
+    uint32_t    start_pct           = 0;
+    uint32_t    end_pct             = 100;
+    std::string format              = "html";       // or "ipuz" (data only, played by www/player.html) or "puz" (Across Lite)
+    bool        html                = true;         // -format html: false writes just the ipuz object
+    bool        print_entry_cnt_and_exit = false;
+    bool        corpus_cache        = true;
+    std::string title               = "";
+    std::string out_path            = "";   // "" means stdout
+    uint32_t    gzip                = 0;    // gzip level for the puzzle, 0 means not compressed
+    std::string batch_path          = "";
+    uint32_t    serve_port          = 0;    // answer UDP requests on this port, 0 means don't (see gen_serve())
+    std::string cache_dir           = "";   // puzzle cache directory, "" means no cache (see PuzCache)
+    uint32_t    cache_mb            = 256;  // size bound of the puzzle cache
+    std::string engine              = "greedy";     // or "csp"
+    std::string pattern_path        = "";   // csp block pattern, "" means generate one
+    bool        symmetry            = true; // generated patterns have 180-degree rotational symmetry
+    uint32_t    block_pct           = 30;   // blocks in generated patterns, at least the lattice's ~25%
+    uint64_t    csp_nodes           = 100000;
+    uint32_t    csp_ms              = 0;    // 0 means no time limit
+    uint32_t    optimize_ms         = 0;    // annealing after the greedy fill, 0 means none
+    uint32_t    time_limit_ms       = 0;    // deadline for the whole puzzle, 0 means none
+    std::string stats               = "";   // "json" writes a report of the grid
+    std::string stats_path          = "";   // "" means stderr, else appended to this file
+    std::string objective           = "words";      // or "density" or "crossings"
+};
+
+void parse_options( Options& opt, const std::vector<std::string>& args )
+{
+    for( size_t i = 0; i < args.size(); i++ )
+    {
+        std::string arg = args[i];
+        if ( arg[0] != '-' ) {
+            // positional <subjects> 
+            dassert( opt.subjects_s == "", "subjects given twice: " + arg );
+            opt.subjects_s = arg;
+            continue;
+        }
+        dassert( (i+1) < args.size(), "missing value for option " + arg );
+               if ( arg == "-debug" ) {                         __debug = std::stoi( args[++i] ); // in sys.h
+        } else if ( arg == "-seed" ) {                          opt.seed = std::stoll( args[++i] );
+        } else if ( arg == "-thread_cnt" ) {                    opt.thread_cnt = std::stoi( args[++i] );
+        } else if ( arg == "-side" ) {                          opt.side = std::stoi( args[++i] );
+        } else if ( arg == "-reverse" ) {                       opt.reverse = std::stoi( args[++i] );
+        } else if ( arg == "-attempts" ) {                      opt.attempts = std::stoi( args[++i] );
+        } else if ( arg == "-larger_cutoff" ) {                 opt.larger_cutoff = std::stoi( args[++i] );
+        } else if ( arg == "-larger_pct" ) {                    opt.larger_pct = std::stoi( args[++i] );
+        } else if ( arg == "-start_pct" ) {                     opt.start_pct = std::stoi( args[++i] );
+        } else if ( arg == "-end_pct" ) {                       opt.end_pct = std::stoi( args[++i] );
+        } else if ( arg == "-format" ) {                        opt.format = args[++i];
+        } else if ( arg == "-html" ) {                          opt.html = std::stoi( args[++i] );
+        } else if ( arg == "-title" ) {                         opt.title = args[++i];
+        } else if ( arg == "-o" ) {                             opt.out_path = args[++i];
+        } else if ( arg == "-gzip" ) {                          opt.gzip = std::stoi( args[++i] );
+        } else if ( arg == "-batch" ) {                         opt.batch_path = args[++i];
+        } else if ( arg == "-serve" ) {                         opt.serve_port = std::stoi( args[++i] );
+        } else if ( arg == "-cache_dir" ) {                     opt.cache_dir = args[++i];
+        } else if ( arg == "-cache_mb" ) {                      opt.cache_mb = std::stoi( args[++i] );
+        } else if ( arg == "-corpus_cache" ) {                  opt.corpus_cache = std::stoi( args[++i] );
+        } else if ( arg == "-print_entry_cnt_and_exit" ) {      opt.print_entry_cnt_and_exit = std::stoi( args[++i] );
+        } else if ( arg == "-engine" ) {                        opt.engine = args[++i];
+        } else if ( arg == "-pattern" ) {                       opt.pattern_path = args[++i];
+        } else if ( arg == "-symmetry" ) {                      opt.symmetry = std::stoi( args[++i] );
+        } else if ( arg == "-block_pct" ) {                     opt.block_pct = std::stoi( args[++i] );
+        } else if ( arg == "-csp_nodes" ) {                     opt.csp_nodes = std::stoll( args[++i] );
+        } else if ( arg == "-csp_ms" ) {                        opt.csp_ms = std::stoi( args[++i] );
+        } else if ( arg == "-optimize_ms" ) {                   opt.optimize_ms = std::stoi( args[++i] );
+        } else if ( arg == "-objective" ) {                     opt.objective = args[++i];
+        } else if ( arg == "-time_limit_ms" ) {                 opt.time_limit_ms = std::stoi( args[++i] );
+        } else if ( arg == "-stats" ) {                         opt.stats = args[++i];
+        } else if ( arg == "-stats_path" ) {                    opt.stats_path = args[++i];
+        } else {                                                die( "unknown option: " + arg ); }
+    }
+    if ( opt.thread_cnt == 0 ) opt.thread_cnt = thread_hardware_thread_cnt();
+    dassert( opt.engine == "greedy" || opt.engine == "csp", "unknown engine: " + opt.engine );
+    dassert( opt.gzip <= 9, "gzip level must be 0 to 9" );
+    dassert( opt.format == "html" || opt.format == "ipuz" || opt.format == "puz", "unknown format: " + opt.format );
+    dassert( opt.objective == "words" || opt.objective == "density" || opt.objective == "crossings", "unknown objective: " + opt.objective );
+    dassert( opt.stats == "" || opt.stats == "json", "unknown stats format: " + opt.stats );
+}
+
+//-----------------------------------------------------------------------
+// Portfolio generation: each thread builds its own grid from its own
+// seed stream and the best grid wins.  Thread 0 uses the seed as given,
+// so -thread_cnt 1 produces the same grid as a single-threaded run.
+//
+// With -engine csp, each thread fills its own block pattern (a generated 
+// one differs per thread, see csp_fill()) and keeps its search counters 
+// in csp[tid].
+// Under a deadline, generating the pattern and the search get half of 
+// the time left, so the greedy fallback still has time to build a grid.
+//-----------------------------------------------------------------------
+struct CspStats
+{
+    uint64_t    node_cnt;
+    uint64_t    backtrack_cnt;
+    uint32_t    slot_cnt;
+    uint32_t    filled_slot_cnt;
+    uint32_t    pattern_cnt;                    // patterns searched
+    bool        complete;
+    bool        greedy_fallback;                // no complete fill, so the greedy engine built the grid
+};
+
+//-----------------------------------------------------------------------
+// Fill the grid by constraint satisfaction on the given pattern or, if 
+// it is "", on generated ones.  Most generated patterns that are not 
+// filled within a few thousand nodes never are (or have no fill at all, 
+// see CspFill), so the -csp_nodes budget is split over CSP_PATTERN_TRIES 
+// patterns, and the next one is tried when a pattern's share runs out or 
+// its tree is exhausted.  Patterns are generated until deadline (0 means 
+// none), and the search stops there too.  The counters in stats cover 
+// every pattern tried.  Returns true if the fill is complete; if not, 
+// the grid is left empty.
+//
+// How big a grid gets filled depends on the corpus.  With the default 
+// budget, on the synthetic test corpora, side 11 grids are nearly always 
+// filled, side 15 grids from rarely to two times in three, and side 21 
+// grids almost never: bigger grids effectively get the greedy engine.  
+// bench_puz reports the rate for each side.
+//-----------------------------------------------------------------------
+const uint32_t CSP_PATTERN_TRIES = 4;
+
+bool csp_fill( Grid& grid, const Options& opt, const std::string& pattern, const WordList& words, const WordIndex& index, 
+               real64 deadline, CspStats& stats )
+{
+    stats = CspStats{};
+    real64 time_end = 0.0;
+    for( uint32_t t = 0; t < CSP_PATTERN_TRIES && stats.node_cnt < opt.csp_nodes; t++ )
+    {
+        std::string p = (pattern != "") ? pattern : pattern_generate( opt.side, opt.symmetry, opt.block_pct, index, deadline );
+        if ( p == "" ) break;
+        if ( t == 0 ) {
+            // -csp_ms counts from the first pattern
+            time_end = (opt.csp_ms != 0) ? (clock_monotonic_time() + real64(opt.csp_ms) / 1000.0) : 0.0;
+            if ( deadline != 0.0 && (time_end == 0.0 || deadline < time_end) ) time_end = deadline;
+        }
+        uint64_t node_max = (pattern != "") ? opt.csp_nodes : std::min( opt.csp_nodes - stats.node_cnt, std::max( opt.csp_nodes / CSP_PATTERN_TRIES, uint64_t(1) ) );
+        CspFill fill( opt.side, p, words, index, node_max, time_end );
+        stats.complete         = fill.fill( grid );
+        stats.node_cnt        += fill.node_cnt;
+        stats.backtrack_cnt   += fill.backtrack_cnt;
+        stats.slot_cnt         = fill.slot_cnt;
+        stats.filled_slot_cnt  = fill.filled_slot_cnt;
+        stats.pattern_cnt++;
+        if ( stats.complete || pattern != "" || (time_end != 0.0 && clock_monotonic_time() >= time_end) ) break;
+    }
+    stats.greedy_fallback = !stats.complete;
+    return stats.complete;
+}
+
+struct Portfolio
+{
+    const Options *           opt;
+    const WordList *          words;
+    const WordIndex *         index;        // csp only
+    std::string               pattern;      // csp only, "" means generate one per thread
+    real64                    deadline;     // clock_monotonic_time(), 0 means none
+    Grid **                   grids;        // one per thread
+    CspStats *                csp;          // one per thread, csp only
+};
+
+void portfolio_thread( uint32_t tid, uint32_t thread_cnt, void * arg )
+{
+    (void)thread_cnt;
+    Portfolio * p = reinterpret_cast<Portfolio *>( arg );
+    const Options * opt = p->opt;
+    rand_thread_seed( opt->seed );
+    register_thread( tid );     // gives this thread a unique seed stream
+    Grid * grid = new Grid( opt->side );
+    if ( opt->engine == "csp" ) {
+        real64 now     = clock_monotonic_time();
+        real64 csp_end = (p->deadline != 0.0) ? (now + (p->deadline - now) / 2.0) : 0.0;
+        if ( !csp_fill( *grid, *opt, p->pattern, *p->words, *p->index, csp_end, p->csp[tid] ) ) {
+            // the grid is still empty; a partial fill is never used
+            grid->generate( *p->words, opt->attempts, opt->larger_cutoff, opt->larger_pct, p->deadline );
+        }
+    } else {
+        grid->generate( *p->words, opt->attempts, opt->larger_cutoff, opt->larger_pct, p->deadline );
+        if ( opt->optimize_ms != 0 && !grid->deadline_hit ) grid->optimize( *p->words, opt->optimize_ms, opt->objective, p->deadline );
+    }
+    p->grids[tid] = grid;
+}
+
+//-----------------------------------------------------------------------
+// 64-bit FNV-1a hash.
+//-----------------------------------------------------------------------
+inline uint64_t hash64( const char * s, size_t len, uint64_t h=0xcbf29ce484222325ULL )
+{
+    for( size_t i = 0; i < len; i++ )
+    {
+        h ^= uint8_t(s[i]);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+//-----------------------------------------------------------------------
+// One <subject>.txt file in one direction, read once per process.
+//
+// The parsed entries and picked words are compiled into a corpus image 
+// that is saved next to the subject file as <subject>.r<reverse>.corpus.  
+// Later runs mmap that file read-only instead of parsing the text again.  
+// The image is rebuilt when the subject file changes.  A matching size, 
+// inode, and nanosecond mtime and ctime are trusted, otherwise the contents 
+// are hashed and compared.  As with git's racy-clean check, a file whose 
+// mtime is within CORPUS_RACY_NS of when the image was built could have 
+// been changed again in the same timestamp tick (some file systems keep 
+// whole seconds), so its stat is not trusted and it is always hashed.
+//
+// Image layout (native byte order, it is only a local cache):
+//
+//     CorpusHeader
+//     CorpusEntry[entry_cnt]
+//     CorpusWord[word_cnt]
+//     char[chars_len]          all strings, referenced by offset
+//-----------------------------------------------------------------------
+const char     CORPUS_MAGIC[8]  = "PUZCORP";
+const uint32_t CORPUS_VERSION   = 2;
+const uint64_t CORPUS_RACY_NS   = 1000000000;
+
+struct CorpusHeader
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    reverse;
+    uint64_t    src_mtime_ns;
+    uint64_t    src_ctime_ns;
+    uint64_t    src_ino;
+    uint64_t    build_time_ns;                  // wall clock time when src_hash was taken
+    uint64_t    src_size;
+    uint64_t    src_hash;
+    uint32_t    entry_cnt;
+    uint32_t    word_cnt;
+    uint64_t    chars_len;
+};
+
+struct CorpusEntry
+{
+    uint32_t    q_off;
+    uint32_t    q_len;
+    uint32_t    a_off;
+    uint32_t    a_len;
+    uint32_t    word_first;
+    uint32_t    word_cnt;
+};
+
+struct CorpusWord
+{
+    uint32_t    word_off;
+    uint32_t    word_len;
+    uint32_t    a_off;                          // the ';'-separated answer that holds the word
+    uint32_t    a_len;
+    uint32_t    pos;
+    uint32_t    pos_last;
+    uint32_t    entry_i;
+};
+
+class Subject
+{
+public:
+    Subject( std::string subject, bool reverse, bool cache_en );
+    ~Subject();
+
+    void     add_to( WordTable& table ) const;  // append the entries and words
+    uint64_t src_hash( void ) const;            // hash of the subject file contents
+
+private:
+    const char *         image;
+    size_t               image_len;
+    bool                 image_is_mapped;
+    std::string          image_owned;           // used when there is no cache file
+
+    bool map_image( std::string path, bool reverse, const struct stat& src_st, const std::string& src_path );
+    void build_image( std::string_view text, bool reverse, const struct stat& src_st, uint64_t src_hash );
+    bool write_image( std::string path );
+};
+
+Subject::Subject( std::string subject, bool reverse, bool cache_en ) : image(nullptr), image_len(0), image_is_mapped(false)
+{
+    std::string src_path   = subject + ".txt";
+    std::string cache_path = subject + (reverse ? ".r1" : ".r0") + ".corpus";
+    struct stat src_st;
+    dassert( stat( src_path.c_str(), &src_st ) == 0, "could not open file " + src_path + " for input" );
+    puz_count( real64 load_start = clock_monotonic_time() );
+    puz_count( real64 parse_ms   = puz_counters.trim_ms + puz_counters.pick_words_ms );
+
+    if ( !cache_en || !map_image( cache_path, reverse, src_st, src_path ) ) {
+        std::string text;
+        file_read( src_path, text );
+        build_image( text, reverse, src_st, hash64( text.c_str(), text.length() ) );
+        if ( cache_en && write_image( cache_path ) ) {
+            // switch over to the mapped copy so that all subjects look the same
+            if ( map_image( cache_path, reverse, src_st, src_path ) ) image_owned = "";
+        }
+    }
+
+    // load time does not include the parsing done by build_image()
+    puz_count( parse_ms = puz_counters.trim_ms + puz_counters.pick_words_ms - parse_ms );
+    puz_count( puz_counters.load_ms += (clock_monotonic_time() - load_start) * 1000.0 - parse_ms );
+}
+
+Subject::~Subject()
+{
+    if ( image_is_mapped ) munmap( const_cast<char *>( image ), image_len );
+}
+
+//-----------------------------------------------------------------------
+// Entry strings and answers are views into the image.  Only the tables 
+// are touched here; those strings are paged in as they are used.  Word 
+// letters are copied into the table's arena.
+//-----------------------------------------------------------------------
+uint64_t Subject::src_hash( void ) const
+{
+    return reinterpret_cast<const CorpusHeader *>( image )->src_hash;
+}
+
+void Subject::add_to( WordTable& table ) const
+{
+    const CorpusHeader * hdr   = reinterpret_cast<const CorpusHeader *>( image );
+    const CorpusEntry *  ce    = reinterpret_cast<const CorpusEntry *>( image + sizeof(CorpusHeader) );
+    const CorpusWord *   cw    = reinterpret_cast<const CorpusWord *>( ce + hdr->entry_cnt );
+    const char *         chars = reinterpret_cast<const char *>( cw + hdr->word_cnt );
+    table.entries.reserve( table.entries.size() + hdr->entry_cnt );
+    table.words.reserve( table.words.size() + hdr->word_cnt );
+    for( uint32_t i = 0; i < hdr->entry_cnt; i++ )
+    {
+        Entry e;
+        e.q          = std::string_view( chars + ce[i].q_off, ce[i].q_len );
+        e.a          = std::string_view( chars + ce[i].a_off, ce[i].a_len );
+        e.word_first = table.words.size();
+        e.word_cnt   = 0;
+        table.entries.push_back( e );
+        for( uint32_t j = ce[i].word_first; j < (ce[i].word_first + ce[i].word_cnt); j++ )
+        {
+            // words from the same answer are next to each other
+            if ( j == ce[i].word_first || cw[j].a_off != cw[j-1].a_off ) {
+                table.answers.push_back( std::string_view( chars + cw[j].a_off, cw[j].a_len ) );
+            }
+            table.add_word( std::string_view( chars + cw[j].word_off, cw[j].word_len ), table.answers.size()-1, cw[j].pos, cw[j].pos_last );
+        }
+    }
+}
+
+//-----------------------------------------------------------------------
+// Map an existing corpus image.  Returns false if there is none or
+// if it is stale or unusable, in which case the caller rebuilds it.
+//-----------------------------------------------------------------------
+bool Subject::map_image( std::string path, bool reverse, const struct stat& src_st, const std::string& src_path )
+{
+    int fd = open( path.c_str(), O_RDONLY );
+    if ( fd < 0 ) return false;
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 || size_t(st.st_size) < sizeof(CorpusHeader) ) {
+        close( fd );
+        return false;
+    }
+    size_t len = st.st_size;
+    void * addr = mmap( nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( addr == MAP_FAILED ) {
+        close( fd );
+        return false;
+    }
+    const char *         m   = reinterpret_cast<const char *>( addr );
+    const CorpusHeader * hdr = reinterpret_cast<const CorpusHeader *>( m );
+    bool ok = memcmp( hdr->magic, CORPUS_MAGIC, sizeof(CORPUS_MAGIC) ) == 0 &&
+              hdr->version == CORPUS_VERSION && hdr->reverse == uint32_t(reverse) &&
+              len == sizeof(CorpusHeader) + hdr->entry_cnt*sizeof(CorpusEntry) + hdr->word_cnt*sizeof(CorpusWord) + hdr->chars_len &&
+              hdr->src_size == uint64_t(src_st.st_size);
+    bool stat_ok = ok && 
+                   hdr->src_mtime_ns == file_mtime_ns( src_st ) && hdr->src_ctime_ns == file_ctime_ns( src_st ) &&
+                   hdr->src_ino == uint64_t(src_st.st_ino) && (hdr->src_mtime_ns + CORPUS_RACY_NS) < hdr->build_time_ns;
+    if ( ok && !stat_ok ) {
+        // touched, edited, or racy; trust only the contents
+        std::string text;
+        file_read( src_path, text );
+        ok = hash64( text.c_str(), text.length() ) == hdr->src_hash;
+        if ( ok ) {
+            // same contents, so just record the new stat for next time
+            int wfd = open( path.c_str(), O_WRONLY );
+            if ( wfd >= 0 ) {
+                uint64_t stamp[4] = { file_mtime_ns( src_st ), file_ctime_ns( src_st ), uint64_t(src_st.st_ino), 
+                                      uint64_t( clock_time() * 1e9 ) };
+                if ( pwrite( wfd, stamp, sizeof(stamp), offsetof(CorpusHeader, src_mtime_ns) ) != sizeof(stamp) ) {
+                    dout << "could not update the stat of " << src_path << " in " << path << "\n";
+                }
+                close( wfd );
+            }
+        }
+    }
+    close( fd );
+    if ( !ok ) {
+        munmap( addr, len );
+        return false;
+    }
+    image           = m;
+    image_len       = len;
+    image_is_mapped = true;
+    return true;
+}
+
+//-----------------------------------------------------------------------
+// Parse the subject file and pick the words, leaving the result in image_owned.
+//-----------------------------------------------------------------------
+void Subject::build_image( std::string_view text, bool reverse, const struct stat& src_st, uint64_t src_hash )
+{
+    uint64_t                 build_time_ns = clock_time() * 1e9;   // the text was read before this
+    std::string              chars;
+    std::vector<CorpusEntry> ces;
+    std::vector<CorpusWord>  cws;
+    auto add_chars = [&]( std::string_view str ) -> uint32_t
+    {
+        uint32_t off = chars.length();
+        chars.append( str.data(), str.length() );
+        return off;
+    };
+
+    std::vector<Entry> parsed;
+    puz_count( real64 trim_start = clock_monotonic_time() );
+    parse_subject( text, parsed );
+    puz_count( puz_counters.trim_ms += (clock_monotonic_time() - trim_start) * 1000.0 );
+    std::vector< PickedWord > picked_words;
+    for( const Entry& pe: parsed )
+    {
+        std::string_view question = reverse ? pe.a : pe.q;
+        std::string_view answer   = reverse ? pe.q : pe.a;
+
+        CorpusEntry ce;
+        ce.q_off      = add_chars( question );
+        ce.q_len      = question.length();
+        ce.a_off      = add_chars( answer );
+        ce.a_len      = answer.length();
+        ce.word_first = cws.size();
+
+        //-----------------------------------------------------------------------
+        // Pull out all interesting answer words, with a reference back to the 
+        // original question.
+        //-----------------------------------------------------------------------
+        size_t a_first = 0;
+        for( ;; )
+        {
+            size_t semi = answer.find( ';', a_first );
+            std::string_view a = trim_left( answer.substr( a_first, (semi == std::string_view::npos) ? std::string_view::npos : (semi - a_first) ) );
+            puz_count( real64 pick_start = clock_monotonic_time() );
+            pick_words( a, picked_words );
+            puz_count( puz_counters.pick_words_ms += (clock_monotonic_time() - pick_start) * 1000.0 );
+            uint32_t a_off = 0;
+            bool     have_a = false;
+            for( auto pw: picked_words )
+            {
+                if ( pw.word.length() > 3 && common_words.find( pw.word ) == common_words.end() ) { 
+                    if ( !have_a ) {
+                        a_off = add_chars( a );
+                        have_a = true;
+                    }
+                    CorpusWord cw;
+                    cw.word_off = add_chars( pw.word );
+                    cw.word_len = pw.word.length();
+                    cw.a_off    = a_off;
+                    cw.a_len    = a.length();
+                    cw.pos      = pw.pos;
+                    cw.pos_last = pw.pos_last;
+                    cw.entry_i  = ces.size();
+                    cws.push_back( cw );
+                }
+            }
+            if ( semi == std::string_view::npos ) break;
+            a_first = semi + 1;
+        }
+        ce.word_cnt = cws.size() - ce.word_first;
+        ces.push_back( ce );
+    }
+
+    CorpusHeader hdr;
+    memset( &hdr, 0, sizeof(hdr) );
+    memcpy( hdr.magic, CORPUS_MAGIC, sizeof(CORPUS_MAGIC) );
+    hdr.version   = CORPUS_VERSION;
+    hdr.reverse   = reverse;
+    hdr.src_mtime_ns  = file_mtime_ns( src_st );
+    hdr.src_ctime_ns  = file_ctime_ns( src_st );
+    hdr.src_ino       = src_st.st_ino;
+    hdr.build_time_ns = build_time_ns;
+    hdr.src_size      = src_st.st_size;
+    hdr.src_hash      = src_hash;
+    hdr.entry_cnt     = ces.size();
+    hdr.word_cnt      = cws.size();
+    hdr.chars_len     = chars.length();
+    image_owned.reserve( sizeof(hdr) + ces.size()*sizeof(CorpusEntry) + cws.size()*sizeof(CorpusWord) + chars.length() );
+    image_owned.append( reinterpret_cast<const char *>( &hdr ), sizeof(hdr) );
+    image_owned.append( reinterpret_cast<const char *>( ces.data() ), ces.size()*sizeof(CorpusEntry) );
+    image_owned.append( reinterpret_cast<const char *>( cws.data() ), cws.size()*sizeof(CorpusWord) );
+    image_owned.append( chars );
+    image     = image_owned.data();
+    image_len = image_owned.length();
+}
+
+//-----------------------------------------------------------------------
+// Write image_owned to a temporary file and rename it into place so that
+// concurrent runs never see a partial image.  Returns false on failure
+// (e.g., read-only directory), in which case the in-memory image is used.
+//-----------------------------------------------------------------------
+bool Subject::write_image( std::string path )
+{
+    std::string tmp_path = path + ".tmp" + std::to_string( getpid() );
+    int fd = open( tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if ( fd < 0 ) return false;
+    bool ok = write( fd, image_owned.data(), image_owned.length() ) == ssize_t(image_owned.length() );
+    ok = (close( fd ) == 0) && ok;
+    ok = ok && rename( tmp_path.c_str(), path.c_str() ) == 0;
+    if ( !ok ) unlink( tmp_path.c_str() );
+    return ok;
+}
+
+//-----------------------------------------------------------------------
+// The entries of one or more subjects, in the direction asked for.
+// Subjects and corpora are cached so that a batch parses each file once.
+//-----------------------------------------------------------------------
+class Corpus
+{
+public:
+    WordTable table;
+    uint64_t  src_hash;                         // hash of the contents of the subject files, in order
+
+    Corpus( std::string subjects_s, bool reverse, bool cache_en );
+
+    // returns nullptr if this would add a corpus past cache_max (0 means no limit)
+    static Corpus * get( std::string subjects_s, bool reverse, bool cache_en, size_t cache_max=0 );
+
+private:
+    static std::map<std::string, Subject *> subjects_cache;
+    static std::map<std::string, Corpus *>  corpora_cache;
+    static std::mutex                       cache_mutex;        // -serve loads from many threads
+};
+
+std::map<std::string, Subject *> Corpus::subjects_cache;
+std::map<std::string, Corpus *>  Corpus::corpora_cache;
+std::mutex                       Corpus::cache_mutex;
+
+Corpus::Corpus( std::string subjects_s, bool reverse, bool cache_en ) : src_hash(0)
+{
+    for( auto subject: split( subjects_s, ',' ) )
+    {
+        std::string key = subject + (reverse ? " 1" : " 0");
+        auto it = subjects_cache.find( key );
+        if ( it == subjects_cache.end() ) {
+            it = subjects_cache.insert( std::make_pair( key, new Subject( subject, reverse, cache_en ) ) ).first;
+        }
+        puz_count( real64 add_start = clock_monotonic_time() );
+        it->second->add_to( table );
+        uint64_t h = it->second->src_hash();
+        src_hash = hash64( reinterpret_cast<const char *>( &h ), sizeof(h), src_hash ^ 0xcbf29ce484222325ULL );
+        puz_count( puz_counters.load_ms += (clock_monotonic_time() - add_start) * 1000.0 );
+    }
+    table.finish();
+}
+
+Corpus * Corpus::get( std::string subjects_s, bool reverse, bool cache_en, size_t cache_max )
+{
+    std::lock_guard<std::mutex> lock( cache_mutex );
+    std::string key = subjects_s + (reverse ? " 1" : " 0");
+    auto it = corpora_cache.find( key );
+    if ( it == corpora_cache.end() ) {
+        if ( cache_max != 0 && corpora_cache.size() >= cache_max ) return nullptr;
+        it = corpora_cache.insert( std::make_pair( key, new Corpus( subjects_s, reverse, cache_en ) ) ).first;
+    }
+    return it->second;
+}
+
+//-----------------------------------------------------------------------
+// Content-addressed cache of generated puzzles (-cache_dir).
+//
+// A puzzle is fully determined by the contents of the subject files and 
+// the options that steer the search and output, so it is stored in a file 
+// named by a 128-bit hash of those (plus PUZ_ENGINE_VERSION, which must be 
+// bumped whenever a change to the generator changes its output).  
+// Puzzles that depend on timing (-optimize_ms, -csp_ms, or a -time_limit_ms 
+// that was hit) are not stored.  -time_limit_ms is not part of the key 
+// since a limit that is not hit does not change the puzzle.
+//
+// Files are written to a temporary name and renamed into place, so 
+// concurrent batch runs and -serve threads can share one directory.  
+// A hit touches the file; when a store takes the directory over 
+// -cache_mb, the least recently used files are removed until it is at 
+// PUZ_CACHE_EVICT_PCT% of that.  The directory is only scanned on the 
+// first store and when the bytes found then plus the bytes stored since 
+// go over -cache_mb, so a -batch run does not scan it for every puzzle.  
+// Stores by other processes are only seen at the next scan.
+//-----------------------------------------------------------------------
+const uint32_t PUZ_ENGINE_VERSION  = 1;
+const uint32_t PUZ_CACHE_EVICT_PCT = 75;
+
+class PuzCache
+{
+public:
+    PuzCache( std::string dir, uint64_t max_bytes );
+
+    static bool        cacheable( const Options& opt );
+    static std::string key( const Options& opt, uint64_t src_hash, const std::string& pattern );
+
+    bool lookup( std::string key, OutBuf& out ) const;
+    void store( std::string key, const OutBuf& out ) const;
+
+private:
+    std::string dir;
+    uint64_t    max_bytes;
+
+    static std::mutex                      bytes_mutex;
+    static std::map<std::string, uint64_t> dir_bytes;   // by dir, as of the last scan plus stores since
+
+    uint64_t evict( void ) const;                       // returns the bytes left
+};
+
+std::mutex                      PuzCache::bytes_mutex;
+std::map<std::string, uint64_t> PuzCache::dir_bytes;
+
+PuzCache::PuzCache( std::string dir, uint64_t max_bytes ) : dir(dir), max_bytes(max_bytes)
+{
+    dassert( mkdir( dir.c_str(), 0755 ) == 0 || errno == EEXIST, "could not create cache directory " + dir + " errno=" + errno_str() );
+}
+
+bool PuzCache::cacheable( const Options& opt )
+{
+    return opt.cache_dir != "" && opt.optimize_ms == 0 && opt.csp_ms == 0 && opt.stats == "";
+}
+
+std::string PuzCache::key( const Options& opt, uint64_t src_hash, const std::string& pattern )
+{
+    std::ostringstream k;
+    k << "v" << PUZ_ENGINE_VERSION << " src=" << src_hash << " side=" << opt.side << " seed=" << opt.seed << 
+         " threads=" << opt.thread_cnt << " reverse=" << opt.reverse << " attempts=" << opt.attempts << 
+         " larger_cutoff=" << opt.larger_cutoff << " larger_pct=" << opt.larger_pct << 
+         " start_pct=" << opt.start_pct << " end_pct=" << opt.end_pct << " engine=" << opt.engine;
+    if ( opt.engine == "csp" ) {
+        k << " pattern=" << hash64( pattern.c_str(), pattern.length() ) << " symmetry=" << opt.symmetry << 
+             " block_pct=" << opt.block_pct << " csp_nodes=" << opt.csp_nodes;
+    }
+    k << " format=" << opt.format << " html=" << opt.html << " gzip=" << opt.gzip << " title=" << opt.title;
+
+    std::string ks = k.str();
+    char name[64];
+    snprintf( name, sizeof(name), "%016llx%016llx.%s%s", 
+              (unsigned long long)hash64( ks.c_str(), ks.length() ), 
+              (unsigned long long)hash64( ks.c_str(), ks.length(), 0x84222325cbf29ce4ULL ),
+              opt.format.c_str(), (opt.gzip != 0) ? ".gz" : "" );
+    return name;
+}
+
+bool PuzCache::lookup( std::string key, OutBuf& out ) const
+{
+    std::string path = dir + "/" + key;
+    int fd = open( path.c_str(), O_RDONLY );
+    if ( fd < 0 ) return false;
+    struct stat st;
+    bool ok = fstat( fd, &st ) == 0;
+    if ( ok ) {
+        out.s.resize( st.st_size );
+        size_t got = 0;
+        while( ok && got < out.s.length() )
+        {
+            ssize_t ret = read( fd, &out.s[got], out.s.length() - got );
+            ok = ret > 0;
+            if ( ok ) got += ret;
+        }
+    }
+    close( fd );
+    if ( ok ) utimes( path.c_str(), nullptr );      // most recently used
+    return ok;
+}
+
+void PuzCache::store( std::string key, const OutBuf& out ) const
+{
+    static std::atomic<uint64_t> tmp_cnt( 0 );
+    std::string path     = dir + "/" + key;
+    std::string tmp_path = path + ".tmp" + std::to_string( getpid() ) + "_" + std::to_string( tmp_cnt++ );
+    int fd = open( tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if ( fd < 0 ) return;                       // the cache is best effort
+    bool ok = write( fd, out.s.data(), out.s.length() ) == ssize_t( out.s.length() );
+    ok = (close( fd ) == 0) && ok;
+    ok = ok && rename( tmp_path.c_str(), path.c_str() ) == 0;
+    if ( !ok ) {
+        unlink( tmp_path.c_str() );
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock( bytes_mutex );
+    auto it = dir_bytes.find( dir );
+    if ( it != dir_bytes.end() ) it->second += out.s.length();     // too much if the file was there, which only scans sooner
+    if ( it == dir_bytes.end() || it->second > max_bytes ) dir_bytes[dir] = evict();
+}
+
+uint64_t PuzCache::evict( void ) const
+{
+    DIR * d = opendir( dir.c_str() );
+    if ( d == nullptr ) return 0;
+    std::vector<std::tuple<real64, uint64_t, std::string>> files;     // mtime, size and path
+    uint64_t total = 0;
+    while( struct dirent * de = readdir( d ) )
+    {
+        std::string name = de->d_name;
+        if ( name[0] == '.' || name.find( ".tmp" ) != std::string::npos ) continue;
+        std::string path = dir + "/" + name;
+        struct stat st;
+        if ( stat( path.c_str(), &st ) != 0 || !S_ISREG( st.st_mode ) ) continue;
+        real64 mtime = real64( file_mtime_ns( st ) ) / 1e9;
+        files.push_back( std::make_tuple( mtime, uint64_t( st.st_size ), path ) );
+        total += st.st_size;
+    }
+    closedir( d );
+    if ( total <= max_bytes ) return total;
+
+    std::sort( files.begin(), files.end() );
+    uint64_t low_bytes = max_bytes / 100 * PUZ_CACHE_EVICT_PCT;
+    for( size_t i = 0; i < files.size() && total > low_bytes; i++ )
+    {
+        unlink( std::get<2>( files[i] ).c_str() );     // may already be gone if another process is evicting
+        total -= std::get<1>( files[i] );
+    }
+    return total;
+}
+
+//-----------------------------------------------------------------------
+// Write out a finished puzzle, or leave it in result.
+//-----------------------------------------------------------------------
+void puz_output( const Options& opt, const OutBuf& out, OutBuf * result )
+{
+    if ( result != nullptr ) {
+        result->s = out.s;
+    } else if ( opt.out_path == "" ) {
+        std::cout.flush();                      // anything already printed goes first
+        out.write_fd( 1, "stdout" );
+    } else {
+        out.write_file( opt.out_path );
+    }
+}
+
+//-----------------------------------------------------------------------
+// Generate one puzzle (or print the entry count) for the given options.
+// With result, the file is left there instead of being written out.
+// Returns false, with nothing written, if no word could be placed 
+// (e.g., the -time_limit_ms deadline passed before the first one).
+//-----------------------------------------------------------------------
+bool gen_puz( Options opt, bool in_batch, OutBuf * result=nullptr )
+{
+    dassert( opt.subjects_s != "", "no subjects given" );
+    dassert( opt.start_pct < opt.end_pct, "start_pct must be < end_pct" );
+    real64 start    = clock_monotonic_time();
+    real64 deadline = (opt.time_limit_ms != 0) ? (start + real64(opt.time_limit_ms) / 1000.0) : 0.0;
+    puz_count( puz_counters.clear() );
+    Corpus * corpus = Corpus::get( opt.subjects_s, opt.reverse, opt.corpus_cache );
+    const std::vector< Entry >& entries = corpus->table.entries;
+
+    uint32_t entry_cnt   = entries.size();
+    if ( opt.print_entry_cnt_and_exit ) {
+        if ( in_batch ) {
+            std::cout << opt.subjects_s << " " << entry_cnt << "\n";
+        } else {
+            std::cout << entry_cnt;
+        }
+        return true;
+    }
+    uint32_t entry_first = float(opt.start_pct)*float(entry_cnt)/100.0;
+    uint32_t entry_last  = std::min( uint32_t( float(opt.end_pct)*float(entry_cnt)/100.0 ), entry_cnt-1 );
+
+    if ( opt.title == "" ) opt.title = join( split( opt.subjects_s, ',' ), "_" ) + "_" + std::to_string(opt.seed);
+
+    //-----------------------------------------------------------------------
+    // With -cache_dir, a puzzle made before from the same inputs is returned as is.
+    //-----------------------------------------------------------------------
+    std::string pattern = (opt.engine == "csp" && opt.pattern_path != "") ? pattern_read( opt.pattern_path, opt.side ) : "";
+    bool        cache_en  = PuzCache::cacheable( opt );
+    std::string cache_key = "";
+    if ( cache_en ) {
+        static thread_local OutBuf hit;
+        cache_key = PuzCache::key( opt, corpus->src_hash, pattern );
+        if ( PuzCache( opt.cache_dir, uint64_t(opt.cache_mb) << 20 ).lookup( cache_key, hit ) ) {
+            puz_output( opt, hit, result );
+            return true;
+        }
+    }
+
+    //-----------------------------------------------------------------------
+    // The words picked from the entries in range, without copying them.
+    //-----------------------------------------------------------------------
+    WordList words( corpus->table, entry_first, entry_last );
+
+    //-----------------------------------------------------------------------
+    // Build one grid per thread and keep the best one.
+    // Ties go to the lowest thread id so the result is deterministic.
+    // The -thread_cnt grids are built on the process-wide thread pool, 
+    // so a batch reuses the same workers for every puzzle.
+    //-----------------------------------------------------------------------
+    Portfolio p;
+    p.opt           = &opt;
+    p.words         = &words;
+    p.index         = nullptr;
+    p.pattern       = "";
+    p.deadline      = deadline;
+    p.grids         = new Grid *[opt.thread_cnt];
+    p.csp           = nullptr;
+    if ( opt.engine == "csp" ) {
+        p.index = new WordIndex( words );
+        p.pattern = pattern;
+        p.csp   = new CspStats[opt.thread_cnt];
+    }
+    puz_count( real64 placement_start = clock_monotonic_time() );
+    thread_pool().parallel_for( 0, opt.thread_cnt, [&p, &opt]( uint64_t t ) { portfolio_thread( t, opt.thread_cnt, &p ); } );
+    puz_count( puz_counters.placement_ms += (clock_monotonic_time() - placement_start) * 1000.0 );
+    puz_count( for( uint32_t t = 0; t < opt.thread_cnt; t++ ) puz_counters.add_attempts( p.grids[t]->counters ) );
+
+    uint32_t best = 0;
+    for( uint32_t t = 1; t < opt.thread_cnt; t++ )
+    {
+        const Grid * g = p.grids[t];
+        const Grid * b = p.grids[best];
+        if ( opt.optimize_ms != 0 && g->objective_value( opt.objective ) != b->objective_value( opt.objective ) ) {
+            if ( g->objective_value( opt.objective ) > b->objective_value( opt.objective ) ) best = t;
+        } else if ( g->is_better_than( *b ) ) {
+            best = t;
+        }
+    }
+    dout << "picked grid from thread " << best << " of " << opt.thread_cnt << " with " << p.grids[best]->placed_cnt << " words\n";
+    if ( opt.engine == "csp" ) {
+        // search counters go to stderr so they don't mix with the puzzle on stdout
+        uint64_t node_cnt      = 0;
+        uint64_t backtrack_cnt = 0;
+        for( uint32_t t = 0; t < opt.thread_cnt; t++ )
+        {
+            node_cnt      += p.csp[t].node_cnt;
+            backtrack_cnt += p.csp[t].backtrack_cnt;
+        }
+        const CspStats& b = p.csp[best];
+        std::cerr << "csp: " << opt.title << " nodes=" << node_cnt << " backtracks=" << backtrack_cnt << 
+                     " best_nodes=" << b.node_cnt << " best_backtracks=" << b.backtrack_cnt << 
+                     " slots=" << b.filled_slot_cnt << "/" << b.slot_cnt << " patterns=" << b.pattern_cnt << " complete=" << b.complete << 
+                     " greedy_fallback=" << b.greedy_fallback << "\n";
+    }
+    uint64_t elapsed_ms = (clock_monotonic_time() - start) * 1000.0;
+    uint32_t hit_cnt    = 0;
+    for( uint32_t t = 0; t < opt.thread_cnt; t++ ) hit_cnt += p.grids[t]->deadline_hit;
+    if ( opt.time_limit_ms != 0 && result == nullptr ) {
+        // the best grid so far is written either way; -serve stays quiet
+        std::cerr << "time_limit: " << opt.title << " limit_ms=" << opt.time_limit_ms << " elapsed_ms=" << elapsed_ms << 
+                     " ended_early=" << (hit_cnt != 0) << " threads_ended_early=" << hit_cnt << "\n";
+    }
+
+    //-----------------------------------------------------------------------
+    // Grid quality report as one line of JSON.
+    //-----------------------------------------------------------------------
+    if ( opt.stats == "json" ) {
+        const Grid& g  = *p.grids[best];
+        GridStats   st = g.stats();
+        uint32_t word_total  = 0;
+        for( const Entry& e: entries ) word_total += e.word_cnt;
+        uint32_t word_usable = 0;
+        for( const Word& w: words ) word_usable += w.len <= opt.side;
+
+        std::ostringstream js;
+        js << "{\"title\": " << json_str( opt.title ) << ", \"engine\": " << json_str( opt.engine ) << 
+              ", \"seed\": " << opt.seed << ", \"side\": " << opt.side <<
+              ", \"words_placed\": " << g.placed_cnt << ", \"across\": " << st.across_cnt << ", \"down\": " << st.down_cnt <<
+              ", \"filled_cells\": " << g.filled_cnt << ", \"density\": " << (real64(g.filled_cnt) / real64(opt.side*opt.side)) <<
+              ", \"crossings\": " << g.cross_cnt << 
+              ", \"avg_word_len\": " << ((g.placed_cnt != 0) ? (real64(st.letter_cnt) / real64(g.placed_cnt)) : 0.0) <<
+              ", \"unchecked_letters\": " << st.unchecked_cnt << ", \"entries_used\": " << st.entry_cnt <<
+              ", \"words_total\": " << word_total << ", \"words_in_range\": " << words.size() << 
+              ", \"words_usable\": " << word_usable << 
+              ", \"usable_share\": " << ((word_total != 0) ? (real64(word_usable) / real64(word_total)) : 0.0);
+        if ( opt.engine == "csp" ) {
+            const CspStats& b = p.csp[best];
+            js << ", \"csp_nodes\": " << b.node_cnt << ", \"csp_backtracks\": " << b.backtrack_cnt << 
+                  ", \"csp_slots\": " << b.slot_cnt << ", \"csp_patterns\": " << b.pattern_cnt << ", \"csp_complete\": " << (b.complete ? "true" : "false") <<
+                  ", \"csp_greedy_fallback\": " << (b.greedy_fallback ? "true" : "false");
+        }
+        js << ", \"elapsed_ms\": " << elapsed_ms << ", \"deadline_hit\": " << ((hit_cnt != 0) ? "true" : "false") << "}\n";
+
+        if ( opt.stats_path == "" ) {
+            std::cerr << js.str();
+        } else {
+            std::ofstream out( opt.stats_path, std::ios::app );
+            dassert( out.is_open(), "could not open file " + opt.stats_path + " for output" );
+            out << js.str();
+            out.close();
+        }
+    }
+
+    //-----------------------------------------------------------------------
+    // Generate .html, .ipuz or .puz file into a buffer that is reused for every 
+    // puzzle on this thread, then write it out with one write().
+    // With -gzip, the file is compressed first (name it .html.gz or .ipuz.gz, 
+    // or serve it with Content-Encoding: gzip).
+    //-----------------------------------------------------------------------
+    bool filled = p.grids[best]->placed_cnt != 0;
+    if ( filled ) {
+        static thread_local OutBuf doc;
+        static thread_local OutBuf doc_gz;
+        doc.clear();
+        if ( opt.format == "ipuz" ) {
+            p.grids[best]->write_ipuz( doc, opt.title );
+        } else if ( opt.format == "puz" ) {
+            p.grids[best]->write_puz( doc, opt.title );
+        } else {
+            p.grids[best]->write( doc, opt.title, opt.html );
+        }
+        puz_count( real64 write_start = clock_monotonic_time() );
+        if ( opt.gzip != 0 ) doc_gz.gzip( doc, opt.gzip );
+        const OutBuf& out = (opt.gzip != 0) ? doc_gz : doc;
+        if ( cache_en && hit_cnt == 0 ) PuzCache( opt.cache_dir, uint64_t(opt.cache_mb) << 20 ).store( cache_key, out );
+        puz_output( opt, out, result );
+        puz_count( puz_counters.output_ms += (clock_monotonic_time() - write_start) * 1000.0 );
+        puz_count( puz_counters.print( std::cerr, opt.title ) );
+    }
+
+    for( uint32_t t = 0; t < opt.thread_cnt; t++ )
+    {
+        delete p.grids[t];
+    }
+    delete[] p.grids;
+    delete p.index;
+    delete[] p.csp;
+    return filled;
+}
+
+//-----------------------------------------------------------------------
+// Split a manifest line or request into whitespace-separated args (no quoting).
+//-----------------------------------------------------------------------
+std::vector<std::string> split_args( std::string_view line )
+{
+    std::vector<std::string> args;
+    std::string arg = "";
+    for( char ch: line )
+    {
+        if ( ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' ) {
+            if ( arg != "" ) args.push_back( arg );
+            arg = "";
+        } else {
+            arg += ch;
+        }
+    }
+    if ( arg != "" ) args.push_back( arg );
+    return args;
+}
+
+//-----------------------------------------------------------------------
+// Batch mode: each non-blank, non-# line of the manifest holds the
+// <subjects> and options for one puzzle, exactly as they would appear
+// on the command line (whitespace-separated, no quoting).  Options given 
+// on the command line are the defaults for every line.  Each subject file 
+// is parsed once for the whole batch.  Lines with -print_entry_cnt_and_exit 1 
+// print "<subjects> <entry_cnt>" on their own line.
+//-----------------------------------------------------------------------
+void gen_batch( const Options& defaults )
+{
+    std::ifstream M( defaults.batch_path );
+    dassert( M.is_open(), "could not open file " + defaults.batch_path + " for input" );
+    uint32_t line_num = 0;
+    for( ;; )
+    {
+        std::string line = readline( M );
+        if ( line == "" ) break;
+        line_num++;
+        std::vector<std::string> args = split_args( line );
+        if ( args.size() == 0 || args[0][0] == '#' ) continue;
+
+        Options opt = defaults;
+        opt.batch_path = "";
+        parse_options( opt, args );
+        dassert( opt.batch_path == "", "-batch is not allowed inside a manifest, line " + std::to_string(line_num) );
+        if ( !gen_puz( opt, true ) ) die( "could not place any words in the grid for manifest line " + std::to_string(line_num) );
+    }
+    M.close();
+}
+
+//-----------------------------------------------------------------------
+// Server mode (-serve <port>): a long-running process that answers UDP 
+// requests, so the subject files are parsed once and the corpora stay 
+// in memory.  Subjects given on the command line are loaded at startup.
+//
+// A request is one datagram holding <subjects> and options as in a 
+// manifest line.  Only these options are allowed, and any other option 
+// given to the server is the default for every request:
+//
+//     -id <n> -side <n> -seed <n> -reverse <0|1> -start_pct <n> -end_pct <n> 
+//     -format <html|ipuz|puz> -html <0|1> -gzip <0-9> -title <name>
+//
+// The puzzle goes back in fragments of at most SERVE_FRAG_LEN bytes.  Each 
+// starts with an 8-byte little-endian header: the request's -id (uint32), 
+// the fragment index and the fragment count (uint16 each), then the payload.
+// A fragment count of 0 means the request was rejected and the payload 
+// is the error message.  Lost fragments are not resent; the client simply 
+// asks again, and gets the same puzzle.  Ask for -gzip 9 to cut the 
+// fragment count.
+//
+// A request without -seed gets the server's -seed, so identical requests 
+// give identical puzzles; clients that want variety send their own -seed.
+//
+// Requests run on the process-wide thread pool, so several are served 
+// at once.  The -DPUZ_COUNTERS counters are not meaningful with -serve.
+//
+// So that a few requests cannot tie up the pool, -side is at most 
+// SERVE_SIDE_MAX; with the server's -attempts, which a request cannot 
+// change, that bounds the work per puzzle.  A server started with 
+// -time_limit_ms, -optimize_ms or -csp_ms gives puzzles that depend on 
+// timing, so asking again may not give the same one.
+//
+// Loaded corpora are never freed, so the subjects of a request are put 
+// in a canonical order (sorted, without repeats: "b,a,b" is "a,b") and 
+// a request that would load more than SERVE_CORPUS_MAX of them, counting 
+// each direction, is rejected.
+//-----------------------------------------------------------------------
+const uint32_t SERVE_REQ_LEN_MAX    = 2048;
+const uint32_t SERVE_FRAG_LEN       = 1400;
+const uint32_t SERVE_HDR_LEN        = 8;
+const uint32_t SERVE_SIDE_MAX       = 64;   // the largest grid with bitboards
+const uint32_t SERVE_CORPUS_MAX     = 64;
+
+// sorted and without repeats, so that each set of subjects has one corpus
+std::string serve_subjects( std::string subjects_s )
+{
+    std::vector<std::string> subjects = split( subjects_s, ',' );
+    std::sort( subjects.begin(), subjects.end() );
+    subjects.erase( std::unique( subjects.begin(), subjects.end() ), subjects.end() );
+    return join( subjects, "," );
+}
+
+void serve_reply( socket_id_t sid, const socket_addr_t& addr, socket_addrlen_t addr_len, uint32_t id, std::string_view payload, bool is_error )
+{
+    const uint32_t max_len  = SERVE_FRAG_LEN - SERVE_HDR_LEN;
+    uint32_t       frag_cnt = is_error ? 0 : std::max( uint32_t( (payload.length() + max_len - 1) / max_len ), uint32_t(1) );
+    dassert( frag_cnt <= 0xffff, "response is too large for -serve" );
+    char frag[SERVE_FRAG_LEN];
+    for( uint32_t f = 0; f == 0 || f < frag_cnt; f++ )
+    {
+        size_t off = size_t(f) * max_len;
+        size_t len = std::min( payload.length() - off, size_t(max_len) );
+        for( uint32_t b = 0; b < 4; b++ ) frag[b] = id >> (8*b);
+        frag[4] = f & 0xff;
+        frag[5] = f >> 8;
+        frag[6] = frag_cnt & 0xff;
+        frag[7] = frag_cnt >> 8;
+        memcpy( frag + SERVE_HDR_LEN, payload.data() + off, len );
+        size_t byte_cnt = 0;
+        for( uint32_t tries = 0; byte_cnt == 0 && tries < 100; tries++ )
+        {
+            udp_socket_sendto( byte_cnt, sid, frag, SERVE_HDR_LEN + len, addr, addr_len );
+            if ( byte_cnt == 0 ) sleep_time( 0.001 );           // socket buffer full
+        }
+    }
+}
+
+// returns "" if the request can be handed to parse_options() and gen_puz(), else the reason not
+std::string serve_check( std::vector<std::string>& args, uint32_t& id )
+{
+    auto is_uint = []( const std::string& v, uint64_t max ) -> bool
+    {
+        if ( v == "" || v.length() > 19 ) return false;
+        for( char ch: v ) if ( ch < '0' || ch > '9' ) return false;
+        return std::stoull( v ) <= max;
+    };
+    auto is_name = []( const std::string& v ) -> bool
+    {
+        if ( v == "" ) return false;
+        for( char ch: v ) if ( !isalnum( uint8_t(ch) ) && ch != '_' && ch != '-' && ch != '.' ) return false;
+        return true;
+    };
+
+    id = 0;
+    std::vector<std::string> kept;
+    bool have_subjects = false;
+    for( size_t i = 0; i < args.size(); i++ )
+    {
+        const std::string& arg = args[i];
+        if ( arg[0] != '-' ) {
+            // parse_options() dies on a second <subjects>
+            if ( have_subjects ) return "subjects given twice: " + arg;
+            have_subjects = true;
+            for( auto subject: split( arg, ',' ) )
+            {
+                if ( !is_name( subject ) || subject[0] == '.' || access( (subject + ".txt").c_str(), R_OK ) != 0 ) return "unknown subject: " + subject;
+            }
+            kept.push_back( serve_subjects( arg ) );
+            continue;
+        }
+        if ( (i+1) >= args.size() ) return "missing value for option " + arg;
+        const std::string& v = args[i+1];
+        bool ok;
+               if ( arg == "-id" ) {                            ok = is_uint( v, 0xffffffff );  if ( ok ) id = std::stoull( v );
+        } else if ( arg == "-side" ) {                          ok = is_uint( v, SERVE_SIDE_MAX ) && std::stoi( v ) >= 3;
+        } else if ( arg == "-seed" ) {                          ok = is_uint( v, uint64_t(1) << 62 );
+        } else if ( arg == "-reverse" || arg == "-html" ) {     ok = v == "0" || v == "1";
+        } else if ( arg == "-start_pct" || arg == "-end_pct" ) {ok = is_uint( v, 100 );
+        } else if ( arg == "-format" ) {                        ok = v == "html" || v == "ipuz" || v == "puz";
+        } else if ( arg == "-gzip" ) {                          ok = is_uint( v, 9 );
+        } else if ( arg == "-title" ) {                         ok = is_name( v );
+        } else {                                                return "option not allowed in a request: " + arg; }
+        if ( !ok ) return "bad value for option " + arg + ": " + v;
+        if ( arg != "-id" ) {
+            kept.push_back( arg );
+            kept.push_back( v );
+        }
+        i++;
+    }
+    args = kept;
+    return "";
+}
+
+//-----------------------------------------------------------------------
+// Answer one request.  Returns true with the puzzle in out, or false with 
+// the reason it was rejected in out.  id is the request's -id, 0 if none.
+//-----------------------------------------------------------------------
+bool serve_answer( const Options& defaults, std::string req, OutBuf& out, uint32_t& id )
+{
+    std::vector<std::string> args = split_args( req );
+    std::string err = serve_check( args, id );
+    Options opt = defaults;
+    opt.serve_port = 0;
+    if ( err == "" ) {
+        parse_options( opt, args );
+        if ( opt.subjects_s == "" ) {
+            err = "no subjects given";
+        } else if ( opt.start_pct >= opt.end_pct ) {
+            err = "start_pct must be < end_pct";
+        } else {
+            Corpus * corpus = Corpus::get( opt.subjects_s, opt.reverse, opt.corpus_cache, SERVE_CORPUS_MAX );
+            if ( corpus == nullptr ) {
+                err = "too many sets of subjects loaded, the limit is " + std::to_string( SERVE_CORPUS_MAX );
+            } else if ( corpus->table.entries.size() == 0 ) {
+                err = "no entries in " + opt.subjects_s;
+            }
+        }
+    }
+    if ( err == "" && !gen_puz( opt, false, &out ) ) err = "could not place any words in the grid";
+    if ( err != "" ) {
+        out.clear();
+        out << err;
+        return false;
+    }
+    return true;
+}
+
+void serve_request( const Options& defaults, socket_id_t sid, std::string req, socket_addr_t addr, socket_addrlen_t addr_len )
+{
+    OutBuf   out;
+    uint32_t id = 0;
+    bool     ok = serve_answer( defaults, req, out, id );
+    serve_reply( sid, addr, addr_len, id, out.s, !ok );
+}
+
+void gen_serve( const Options& defaults )
+{
+    dassert( defaults.out_path == "" && defaults.stats == "" && !defaults.print_entry_cnt_and_exit, 
+             "-o, -stats and -print_entry_cnt_and_exit cannot be used with -serve" );
+    if ( defaults.subjects_s != "" ) {
+        Corpus::get( serve_subjects( defaults.subjects_s ), false, defaults.corpus_cache );
+        Corpus::get( serve_subjects( defaults.subjects_s ), true,  defaults.corpus_cache );
+    }
+
+    socket_id_t      sid;
+    socket_addr_t    local_addr;
+    socket_addrlen_t local_addr_len;
+    udp_socket_create_unicast( sid, local_addr, local_addr_len, "", defaults.serve_port, false );
+    std::cerr << "serving on udp port " << defaults.serve_port << "\n";
+
+    Options opt = defaults;
+    opt.subjects_s = "";                        // each request names its own
+    char buffer[SERVE_REQ_LEN_MAX];
+    for( ;; )
+    {
+        size_t           byte_cnt;
+        socket_addr_t    remote_addr;
+        socket_addrlen_t remote_addr_len;
+        udp_socket_recvfrom( byte_cnt, sid, buffer, sizeof(buffer), remote_addr, remote_addr_len );
+        if ( byte_cnt == 0 ) continue;
+        std::string req( buffer, byte_cnt );
+        thread_pool().submit( [opt, sid, req, remote_addr, remote_addr_len] { serve_request( opt, sid, req, remote_addr, remote_addr_len ); } );
+    }
+}
+
+#endif
@@ -41,6 +41,8 @@
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
 
@@ -54,6 +56,11 @@
 #include <map>
 #include <unordered_map>
 #include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <atomic>
+#include <functional>
 #include <regex>
 #include <algorithm>
 
@@ -433,11 +440,47 @@ inline uint32_t bits_find_nth_one_before_with_wrap( uint32_t bits, uint32_t star
     return i;
 }
 
+//--------------------------------------------------------- 
+// 64-bit Bit Twiddling
+//
+// These are used in inner loops, so they use the compiler builtins 
+// rather than looping over the bits.
+//--------------------------------------------------------- 
+inline uint64_t bits64_lt( uint32_t b )
+{
+    return (b >= 64) ? ~uint64_t(0) : ((uint64_t(1) << b) - 1);
+}
+
+inline uint32_t bits64_count_ones( uint64_t bits )
+{
+    return __builtin_popcountll( bits );
+}
+
+inline uint32_t bits64_count_trailing_zeroes( uint64_t bits )
+{
+    return (bits == 0) ? 64 : __builtin_ctzll( bits );
+}
+
+inline bool bit64_is_one( uint64_t bits, uint32_t b )
+{
+    return (bits >> b) & 1;
+}
+
+inline void bit64_set( uint64_t& bits, uint32_t b )
+{
+    bits |= uint64_t(1) << b;
+}
+
+inline void bit64_clear( uint64_t& bits, uint32_t b )
+{
+    bits &= ~(uint64_t(1) << b);
+}
+
 //--------------------------------------------------------- 
 // Date and Time
 //
 // Times are real64 seconds with high-precision fractional seconds.
-// Clock times are since the epoch (1/1/1970).
+// Clock times are since the epoch (1/1/1970), except clock_monotonic_time().
 //--------------------------------------------------------- 
 inline real64 clock_time( void ) 
 {
@@ -447,6 +490,15 @@ inline real64 clock_time( void )
     return real64(ts.tv_sec) + real64(ts.tv_nsec)/real64(1000000000);
 }
 
+inline real64 clock_monotonic_time( void ) 
+{
+    // Return number of seconds on a clock that never jumps (not related to the epoch).
+    // Use this for deadlines and elapsed times.
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return real64(ts.tv_sec) + real64(ts.tv_nsec)/real64(1000000000);
+}
+
 inline void sleep_time( real64 secs ) 
 {
     // Sleep for the given seconds which can be fractional.
@@ -549,6 +601,234 @@ void thread_parallelize( uint32_t thread_cnt, void (*fn)(uint32_t, uint32_t, voi
     delete[] threads;
 }
 
+//--------------------------------------------------------- 
+// Persistent thread pool with work stealing.
+//
+// Each worker has its own deque of tasks.  A worker runs its own tasks 
+// newest first and steals the oldest tasks of other workers when it runs 
+// out.  Tasks submitted from a worker go onto its own deque, others are 
+// spread round-robin.
+//
+// submit() returns a future for the result of the task.  
+// parallel_for() calls fn(i) for i in [first, last) in chunks of grain 
+// indexes and returns when all are done.  The caller runs chunks itself 
+// and helps with other queued tasks while it waits, so parallel_for() 
+// may be nested inside tasks.  A task should not wait on a future 
+// from submit(), since that ties up its worker.
+//
+// shutdown() (or the destructor) runs the tasks already queued, then 
+// joins the workers.  thread_pool() is a pool shared by the whole 
+// process that is never shut down.
+//--------------------------------------------------------- 
+class ThreadPool
+{
+public:
+    ThreadPool( uint32_t thread_cnt=0, size_t stack_size=8*1024*1024 );     // 0 means thread_hardware_thread_cnt()
+    ~ThreadPool();
+
+    inline uint32_t thread_cnt( void ) const { return workers.size(); }
+
+    template<typename Fn> 
+    std::future<std::invoke_result_t<Fn>> submit( Fn fn );
+
+    template<typename Fn> 
+    void parallel_for( uint64_t first, uint64_t last, Fn fn, uint64_t grain=1 );
+
+    void shutdown( void );
+
+private:
+    struct Worker
+    {
+        ThreadPool *                      pool;
+        uint32_t                          index;
+        tid_t                             ptid;
+        std::mutex                        mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<Worker *>   workers;
+    std::mutex              wake_mutex;
+    std::condition_variable wake;
+    std::atomic<uint64_t>   queued_cnt;
+    std::atomic<uint32_t>   next_worker;
+    bool                    stopping;
+
+    static inline thread_local Worker * my_worker = nullptr;
+
+    void         push( std::function<void()> task );
+    bool         run_one( void );
+    static void * worker_main( void * arg );
+};
+
+inline ThreadPool::ThreadPool( uint32_t thread_cnt, size_t stack_size ) : queued_cnt(0), next_worker(0), stopping(false)
+{
+    if ( thread_cnt == 0 ) thread_cnt = thread_hardware_thread_cnt();
+    if ( thread_cnt == 0 ) thread_cnt = 1;
+    for( uint32_t i = 0; i < thread_cnt; i++ )
+    {
+        Worker * w = new Worker;
+        w->pool  = this;
+        w->index = i;
+        workers.push_back( w );
+    }
+    for( Worker * w: workers )
+    {
+        thread_create( w->ptid, worker_main, w, stack_size );
+    }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+    shutdown();
+}
+
+inline void ThreadPool::shutdown( void )
+{
+    {
+        std::lock_guard<std::mutex> lock( wake_mutex );
+        if ( stopping ) return;
+        stopping = true;
+    }
+    wake.notify_all();
+    for( Worker * w: workers )
+    {
+        thread_join( w->ptid );
+    }
+    for( Worker * w: workers )
+    {
+        delete w;
+    }
+    workers.clear();
+}
+
+inline void ThreadPool::push( std::function<void()> task )
+{
+    dassert( !stopping, "task submitted to a ThreadPool after shutdown()" );
+    Worker * w = (my_worker != nullptr && my_worker->pool == this) ? my_worker : workers[next_worker++ % workers.size()];
+    {
+        std::lock_guard<std::mutex> lock( w->mutex );
+        w->tasks.push_back( std::move( task ) );
+    }
+    {
+        std::lock_guard<std::mutex> lock( wake_mutex );
+        queued_cnt++;
+    }
+    wake.notify_one();
+}
+
+// runs one queued task if there is one: our own newest, else the oldest of another worker
+inline bool ThreadPool::run_one( void )
+{
+    Worker * self  = (my_worker != nullptr && my_worker->pool == this) ? my_worker : nullptr;
+    uint32_t cnt   = workers.size();
+    uint32_t start = (self != nullptr) ? self->index : 0;
+    for( uint32_t i = 0; i < cnt; i++ )
+    {
+        Worker * w = workers[(start + i) % cnt];
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock( w->mutex );
+            if ( w->tasks.empty() ) continue;
+            if ( w == self ) {
+                task = std::move( w->tasks.back() );
+                w->tasks.pop_back();
+            } else {
+                task = std::move( w->tasks.front() );
+                w->tasks.pop_front();
+            }
+        }
+        queued_cnt--;
+        task();
+        return true;
+    }
+    return false;
+}
+
+inline void * ThreadPool::worker_main( void * arg )
+{
+    Worker *     w    = reinterpret_cast<Worker *>( arg );
+    ThreadPool * pool = w->pool;
+    my_worker = w;
+    for( ;; ) 
+    {
+        if ( pool->run_one() ) continue;
+        std::unique_lock<std::mutex> lock( pool->wake_mutex );
+        pool->wake.wait( lock, [pool]{ return pool->stopping || pool->queued_cnt != 0; } );
+        if ( pool->stopping && pool->queued_cnt == 0 ) break;
+    }
+    return nullptr;
+}
+
+template<typename Fn> 
+inline std::future<std::invoke_result_t<Fn>> ThreadPool::submit( Fn fn )
+{
+    using R = std::invoke_result_t<Fn>;
+    auto task = std::make_shared<std::packaged_task<R()>>( std::move( fn ) );  // std::function needs a copyable target
+    std::future<R> result = task->get_future();
+    push( [task]{ (*task)(); } );
+    return result;
+}
+
+template<typename Fn> 
+inline void ThreadPool::parallel_for( uint64_t first, uint64_t last, Fn fn, uint64_t grain )
+{
+    if ( last <= first ) return;
+    if ( grain == 0 ) grain = 1;
+    uint64_t chunk_cnt = (last - first + grain - 1) / grain;
+
+    struct State 
+    {
+        std::atomic<uint64_t>   next_chunk;
+        uint32_t                helper_cnt;
+        uint32_t                helpers_done;
+        std::mutex              mutex;
+        std::condition_variable done;
+    } st;
+    st.next_chunk   = 0;
+    st.helper_cnt   = std::min( uint64_t( thread_cnt() ), chunk_cnt - 1 );
+    st.helpers_done = 0;
+
+    auto run_chunks = [&st, &fn, first, last, grain, chunk_cnt]
+    {
+        for( ;; )
+        {
+            uint64_t c = st.next_chunk++;
+            if ( c >= chunk_cnt ) break;
+            uint64_t c_last = std::min( first + (c+1)*grain, last );
+            for( uint64_t i = first + c*grain; i < c_last; i++ ) fn( i );
+        }
+    };
+    for( uint32_t h = 0; h < st.helper_cnt; h++ )
+    {
+        push( [&st, &run_chunks] 
+        {
+            run_chunks();
+            std::lock_guard<std::mutex> lock( st.mutex );
+            if ( ++st.helpers_done == st.helper_cnt ) st.done.notify_all();
+        } );
+    }
+    run_chunks();
+
+    // st is on our stack, so wait for every helper, even those that found no chunk left
+    for( ;; )
+    {
+        {
+            std::lock_guard<std::mutex> lock( st.mutex );
+            if ( st.helpers_done == st.helper_cnt ) break;
+        }
+        if ( run_one() ) continue;
+        std::unique_lock<std::mutex> lock( st.mutex );
+        st.done.wait( lock, [&st]{ return st.helpers_done == st.helper_cnt; } );
+        break;
+    }
+}
+
+inline ThreadPool& thread_pool( void )
+{
+    static ThreadPool * pool = new ThreadPool();        // never deleted, so exit() from a task is safe
+    return *pool;
+}
+
 //--------------------------------------------------------- 
 // Regular Expression Utility Functions
 //--------------------------------------------------------- 
@@ -621,9 +901,14 @@ inline std::string indent_str(uint32_t cnt) {
 
 inline std::string errno_str( void )
 {
-    char s[256];
-    strerror_r( errno, s, sizeof(s) );
-    return std::to_string( errno ) + " (" + s + ")";
+    int  e = errno;
+    char s[256] = "";
+#if defined(__GLIBC__) && defined(_GNU_SOURCE)
+    const char * msg = strerror_r( e, s, sizeof(s) );      // the GNU version may return a static string instead
+#else
+    const char * msg = (strerror_r( e, s, sizeof(s) ) == 0) ? s : "unknown error";
+#endif
+    return std::to_string( e ) + " (" + msg + ")";
 }
 
 using socket_id_t = int;
@@ -716,7 +1001,9 @@ socket_addr_info_t * socket_addr_info_udp_alloc( std::string ip_addr, uint32_t p
         struct sockaddr_in * addr_in = new struct sockaddr_in;
         addr                     = reinterpret_cast<struct sockaddr *>( addr_in );
         addr_len                 = sizeof( struct sockaddr_in );
-        addr_in->sin_len         = addr_len;
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+        addr_in->sin_len         = addr_len;    // BSD sockaddrs carry their length, Linux ones don't
+#endif
         addr_in->sin_family      = family;
         addr_in->sin_port        = htons( port );
         if ( ip_addr == "" ) {
@@ -729,7 +1016,9 @@ socket_addr_info_t * socket_addr_info_udp_alloc( std::string ip_addr, uint32_t p
         struct sockaddr_in6 * addr_in = new struct sockaddr_in6;
         addr                     = reinterpret_cast<struct sockaddr *>( addr_in );
         addr_len                 = sizeof( struct sockaddr_in6 );
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
         addr_in->sin6_len        = addr_len;
+#endif
         addr_in->sin6_family     = AF_INET6;
         addr_in->sin6_flowinfo   = 0;
         addr_in->sin6_family     = family;